@@ -12,6 +12,8 @@ namespace micro_recirc {
 struct MicroRecircArgs {
 
     struct Arg {
+        static constexpr auto TXN_NAME = "micro_recirc";
+
         uint32_t recircs = 0;
         bool on_switch = true;
     };
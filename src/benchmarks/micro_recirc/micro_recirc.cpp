@@ -17,20 +17,15 @@ void micro_recirc_worker(int id, Database& db, TxnExecutorStats& stats) {
 
     MicroRecircRandom rnd(config.node_id << 16 | id);
 
-    std::vector<MicroRecirc::Arg_t> txns;
-    txns.reserve(config.num_txns);
-    for (size_t i = 0; i < config.num_txns; ++i) {
-
+    auto txns = make_txn_generator<MicroRecirc::Arg_t>([&]() -> MicroRecirc::Arg_t {
         MicroRecircArgs::Arg txn;
         txn.recircs = rnd.is_multipass();
-
-        txns.push_back(txn);
-    }
+        return txn;
+    });
 
     db.msg_handler->barrier.wait_workers();
 
     stats = txn_executor<MicroRecirc>(db, txns);
-    stats.count_on_switch(txns);
 }
 
 
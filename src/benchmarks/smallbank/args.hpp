@@ -13,30 +13,42 @@ namespace smallbank {
 
 struct SmallbankArgs {
     struct Balance {
+        static constexpr auto TXN_NAME = "smallbank_balance";
+
         uint64_t customer_id;
         bool on_switch;
     };
     struct DepositChecking {
+        static constexpr auto TXN_NAME = "smallbank_deposit_checking";
+
         uint64_t customer_id;
         int32_t val;
         bool on_switch;
     };
     struct TransactSaving {
+        static constexpr auto TXN_NAME = "smallbank_transact_saving";
+
         uint64_t customer_id;
         int32_t val;
         bool on_switch;
     };
     struct Amalgamate {
+        static constexpr auto TXN_NAME = "smallbank_amalgamate";
+
         uint64_t customer_id_1;
         uint64_t customer_id_2;
         bool on_switch;
     };
     struct WriteCheck {
+        static constexpr auto TXN_NAME = "smallbank_write_check";
+
         uint64_t customer_id;
         int32_t val;
         bool on_switch;
     };
     struct SendPayment {
+        static constexpr auto TXN_NAME = "smallbank_send_payment";
+
         uint64_t customer_id_1;
         uint64_t customer_id_2;
         int32_t val;
@@ -0,0 +1,61 @@
+#pragma once
+
+#include "db/fragment.hpp"
+#include "table.hpp"
+
+
+namespace benchmark {
+namespace smallbank {
+
+// Single-tuple txns, shipped to the owner of the account with --ship_fragments.
+struct SmallbankFragments {
+    using Saving = SmallbankTableInfo::Saving;
+    using Checking = SmallbankTableInfo::Checking;
+
+    struct DepositChecking {
+        static constexpr uint16_t ID = 0;
+        static constexpr AccessMode::value_t MODE = AccessMode::WRITE;
+        using Tuple_t = Checking;
+        struct Args {
+            int32_t val;
+        };
+        struct Result {
+            int32_t balance;
+        };
+
+        static bool apply(Tuple_t& checking, const Args& args, Result& result) {
+            checking.balance += args.val;
+            result.balance = checking.balance;
+            return true;
+        }
+    };
+
+    struct TransactSaving {
+        static constexpr uint16_t ID = 1;
+        static constexpr AccessMode::value_t MODE = AccessMode::WRITE;
+        using Tuple_t = Saving;
+        struct Args {
+            int32_t val;
+        };
+        struct Result {
+            int32_t balance;
+        };
+
+        static bool apply(Tuple_t& saving, const Args& args, Result& result) {
+            if ((saving.balance + args.val) < 0) {
+                return false;
+            }
+            saving.balance += args.val;
+            result.balance = saving.balance;
+            return true;
+        }
+    };
+
+    static void register_all() {
+        fragments::Registry::get().add<DepositChecking>();
+        fragments::Registry::get().add<TransactSaving>();
+    }
+};
+
+} // namespace smallbank
+} // namespace benchmark
@@ -1,6 +1,7 @@
 #include "smallbank.hpp"
 
 #include "db/config.hpp"
+#include "fragments.hpp"
 #include "random.hpp"
 #include "transaction.hpp"
 
@@ -17,9 +18,7 @@ void smallbank_worker(int id, Database& db, TxnExecutorStats& stats) {
 
     SmallbankRandom rnd(config.node_id << 16 | id);
 
-    std::vector<Smallbank::Arg_t> txns;
-    txns.reserve(config.num_txns);
-    for (size_t i = 0; i < config.num_txns; ++i) {
+    auto txns = make_txn_generator<Smallbank::Arg_t>([&]() {
         bool is_hot_txn = rnd.is_hot_txn();
 
         auto get_account = [&]() {
@@ -83,14 +82,12 @@ void smallbank_worker(int id, Database& db, TxnExecutorStats& stats) {
             throw std::runtime_error("smallbank random fail");
         };
 
-        auto txn = get_txn();
-        txns.push_back(txn);
-    }
+        return get_txn();
+    });
 
     db.msg_handler->barrier.wait_workers();
 
     stats = txn_executor<Smallbank>(db, txns);
-    stats.count_on_switch(txns);
 }
 
 
@@ -144,6 +141,7 @@ int smallbank() {
         // }
     }
 
+    SmallbankFragments::register_all();
     db.msg_handler->barrier.wait_nodes();
 
 
@@ -1,5 +1,6 @@
 #pragma once
 
+#include "db/database.hpp"
 #include "switch.hpp"
 #include "table/table.hpp"
 
@@ -1,3 +1,4 @@
+#include "../fragments.hpp"
 #include "../transaction.hpp"
 
 
@@ -18,11 +19,9 @@ Smallbank::RC Smallbank::operator()(SmallbankArgs::DepositChecking& arg) {
     }
 
 
-    auto checking_f = write(checking, Checking::pk(arg.customer_id));
-    check(checking_f);
-    auto checking = checking_f->get();
-    check(checking);
-    checking->balance += arg.val;
+    auto deposit_f = call<SmallbankFragments::DepositChecking>(checking, Checking::pk(arg.customer_id), {arg.val}, true);
+    check(deposit_f);
+    check(deposit_f->get());
 
     WorkerContext::get().cntr.incr(stats::Counter::smallbank_deposit_checking_commits);
     return commit();
@@ -9,6 +9,7 @@ Smallbank::RC Smallbank::operator()(SmallbankArgs::SendPayment& arg) {
         auto txn_f = atomic(p4_switch, SmallbankSwitchInfo::SendPayment{arg.customer_id_1, arg.customer_id_2, arg.val});
         auto& _switch_payment = txn_f->get();
         if (_switch_payment.abort) {
+            WorkerContext::get().aborts.set_cause(stats::Aborts::on_switch, checking->id, Checking::pk(arg.customer_id_1), AccessMode::WRITE);
             return rollback();
         }
         WorkerContext::get().cntr.incr(stats::Counter::smallbank_send_payment_commits);
@@ -1,3 +1,4 @@
+#include "../fragments.hpp"
 #include "../transaction.hpp"
 
 
@@ -12,15 +13,11 @@ Smallbank::RC Smallbank::operator()(SmallbankArgs::TransactSaving& arg) {
         return commit();
     }
 
-    auto saving_f = write(saving, Saving::pk(arg.customer_id)); // Opportunity for lock upgrade
-    check(saving_f);
-    auto saving = saving_f->get();
-    check(saving);
-
-    if ((saving->balance + arg.val) < 0) {
+    auto transact_f = call<SmallbankFragments::TransactSaving>(saving, Saving::pk(arg.customer_id), {arg.val}, true);
+    check(transact_f);
+    if (!transact_f->get()) { // balance would become negative
         return rollback();
     }
-    saving->balance += arg.val;
 
     WorkerContext::get().cntr.incr(stats::Counter::smallbank_transact_saving_commits);
     return commit();
@@ -11,6 +11,8 @@ namespace tpcc {
 
 struct TPCCArgs {
     struct NewOrder {
+        static constexpr auto TXN_NAME = "tpcc_new_order";
+
         uint64_t w_id;
         uint64_t d_id;
         uint64_t c_id;
@@ -32,6 +34,8 @@ struct TPCCArgs {
     };
 
     struct Payment {
+        static constexpr auto TXN_NAME = "tpcc_payment";
+
         uint64_t w_id;
         uint64_t d_id;
         uint64_t c_w_id;
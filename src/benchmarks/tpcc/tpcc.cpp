@@ -28,9 +28,7 @@ void tpcc_worker(int id, Database& db, TxnExecutorStats& stats) {
         throw std::runtime_error("is_home_wh failed");
     }
 
-    std::vector<TPCCArgs::Arg_t> txns;
-    txns.reserve(config.num_txns);
-    for (size_t i = 0; i < config.num_txns; ++i) {
+    auto txns = make_txn_generator<TPCCArgs::Arg_t>([&]() {
         // tpc-c_v5.11.0.pdf -> pp. 28
         auto new_order = [&]() -> TPCCArgs::Arg_t {
             uint64_t w_id = home_w_id; // constant over the whole measurement interval
@@ -115,14 +113,12 @@ void tpcc_worker(int id, Database& db, TxnExecutorStats& stats) {
             return txn;
         };
 
-        auto txn = (rnd.random<int>(1, 100) <= FREQUENCY_NEW_ORDER) ? new_order() : payment();
-        txns.push_back(txn);
-    }
+        return (rnd.random<int>(1, 100) <= FREQUENCY_NEW_ORDER) ? new_order() : payment();
+    });
 
     db.msg_handler->barrier.wait_workers();
 
     stats = txn_executor<TPCC>(db, txns);
-    stats.count_on_switch(txns);
 }
 
 
@@ -13,6 +13,8 @@ namespace ycsb {
 
 struct YCSBArgs {
     struct Write {
+        static constexpr auto TXN_NAME = "ycsb_write";
+
         uint64_t id;
         uint32_t value;
         bool on_switch;
@@ -20,6 +22,8 @@ struct YCSBArgs {
     };
 
     struct Read {
+        static constexpr auto TXN_NAME = "ycsb_read";
+
         uint64_t id;
         bool on_switch;
         bool is_hot;
@@ -27,6 +31,8 @@ struct YCSBArgs {
 
     template <std::size_t N>
     struct Multi {
+        static constexpr auto TXN_NAME = "ycsb_multi";
+
         struct OP {
             uint64_t id;
             AccessMode mode;
@@ -22,9 +22,7 @@ void ycsb_worker(int id, Database& db, TxnExecutorStats& stats) {
     ti.link_tables(db);
 
 
-    std::vector<YCSB::Arg_t> txns;
-    txns.reserve(config.num_txns);
-    for (size_t i = 0; i < config.num_txns; ++i) {
+    auto txns = make_txn_generator<YCSB::Arg_t>([&]() {
         bool is_hot_txn = rnd.is_hot_txn();
 
         auto get_txn = [&]() -> YCSB::Arg_t {
@@ -109,15 +107,12 @@ void ycsb_worker(int id, Database& db, TxnExecutorStats& stats) {
             }
         };
 
-        auto txn = get_txn();
-        txns.push_back(txn);
-    }
-    // std::random_shuffle(txns.begin(), txns.end());
+        return get_txn();
+    });
 
     db.msg_handler->barrier.wait_workers();
 
     stats = txn_executor<YCSB>(db, txns);
-    stats.count_on_switch(txns);
 }
 
 
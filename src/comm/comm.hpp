@@ -1,8 +1,52 @@
 #pragma once
 
 
-// #include "udp.hpp"
-// using Communicator = UDPCommunicator;
-
+// selected with meson configure -Dcomm=...
+#if defined(P4DB_COMM_SHM)
+#include "shm.hpp"
+using Communicator = ShmCommunicator;
+#elif defined(P4DB_COMM_UDP)
+#include "udp.hpp"
+using Communicator = UDPCommunicator;
+#elif defined(P4DB_COMM_URING)
+#include "uring.hpp"
+using Communicator = IoUringCommunicator;
+#elif defined(P4DB_COMM_XDP)
+#include "xdp.hpp"
+using Communicator = XDPCommunicator;
+#else
 #include "dpdk.hpp"
 using Communicator = DPDKCommunicator;
+#endif
+
+
+// Stages the sends of tx-queue tid while in scope and flushes them as bursts
+// at the end, for send loops like the undolog puts.
+class TxBatch {
+    Communicator* comm;
+    uint32_t tid;
+
+public:
+    TxBatch(Communicator* comm, uint32_t tid) : comm(comm), tid(tid) {
+        comm->begin_batch(tid);
+    }
+
+    ~TxBatch() {
+        comm->end_batch(tid);
+    }
+
+    TxBatch(const TxBatch&) = delete;
+    TxBatch& operator=(const TxBatch&) = delete;
+};
+
+
+// Chains payload to the end of pkt instead of copying it (--zero_copy_bytes),
+// only the dpdk transport can. False if the caller has to copy it.
+template <typename Comm_t>
+bool attach_payload(Comm_t& comm, typename Comm_t::Pkt_t* pkt, const void* payload, uint16_t len) {
+    if constexpr (requires { comm.attach(pkt, payload, len); }) {
+        return comm.attach(pkt, payload, len);
+    } else {
+        return false;
+    }
+}
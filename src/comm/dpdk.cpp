@@ -2,6 +2,7 @@
 
 #include "comm/msg_handler.hpp"
 #include "db/config.hpp"
+#include "stats/collector.hpp"
 #include "stats/stats.hpp"
 
 #include <fmt/core.h>
@@ -26,9 +27,18 @@ DPDKCommunicator::DPDKCommunicator() {
     num_tx_queues = config.num_txn_workers + 1 /* handler */ + 1 /* spin-lock */; // + 1 + config->txn_agents; // 0 with spin-lock , 1 for table-agent, 2++ for txn_agents
     mh_tid = config.num_txn_workers;
     spin_tx_queue = config.num_txn_workers + 1;
-    if (!device->openMultiQueues(num_rx_queues, num_tx_queues)) {
+    DpdkDevice::DpdkDeviceConfiguration dev_config;
+    dev_config.multiSegTx = config.zero_copy_bytes > 0;
+    if (!device->openMultiQueues(num_rx_queues, num_tx_queues, dev_config)) {
         EXIT_WITH_ERROR("Couldn't open Dpdk device #%d, PMD '%s'", device->getDeviceId(), device->getPMDName().c_str());
     }
+    tx_buffers = std::make_unique<TxBuffer[]>(num_tx_queues);
+
+    zero_copy_bytes = config.zero_copy_bytes;
+    if (zero_copy_bytes > 0 && !device->supportsMultiSegTx()) {
+        std::cerr << "zero_copy_bytes: PMD '" << device->getPMDName() << "' cannot send chained mbufs, tuples are copied\n";
+        zero_copy_bytes = 0;
+    }
 
     MacAddress mac = device->getMacAddress();
     src_mac = eth_addr_t{mac.m_Address[0], mac.m_Address[1], mac.m_Address[2], mac.m_Address[3], mac.m_Address[4], mac.m_Address[5]};
@@ -42,47 +52,25 @@ DPDKCommunicator::DPDKCommunicator() {
         throw std::runtime_error("macs do not match");
     }
 
-    stats_thread = std::jthread([&](std::stop_token token) {
-        // auto& config = Config::instance();
-
-        // pin_worker(config.num_txn_workers);
-        // logger::info("Press ENTER for stats.");
-        for (uint64_t i = 1; !token.stop_requested(); i++) {
-            std::this_thread::sleep_for(std::chrono::milliseconds(1000));
-            continue;
-
-            printf("Stats #%zu\n==========\n", i);
-
-            DpdkDevice::DpdkDeviceStats stats;
-            device->getStatistics(stats);
-
-            std::stringstream ss;
-            ss << "\nStatistics for port " << device->getDeviceId() << ":\n";
-
-            ss << fmt::format("{:>10} {:>15} {:>15} {:>15} {:>15} {:>15}\n", " ", "Total Packets", "Packets/sec", "Total Bytes", "Bytes/sec", "Gbps");
-
-            ss << fmt::format("{:10} {:15} {:15} {:15} {:15} {:15.4f}\n", "rx",
-                              stats.aggregatedRxStats.packets, stats.aggregatedRxStats.packetsPerSec, stats.aggregatedRxStats.bytes,
-                              stats.aggregatedRxStats.bytesPerSec, stats.aggregatedRxStats.bytesPerSec / 1.25e+8);
-
-            ss << fmt::format("{:10} {:15} {:15} {:15} {:15} {:15.4f}\n", "tx",
-                              stats.aggregatedTxStats.packets, stats.aggregatedTxStats.packetsPerSec, stats.aggregatedTxStats.bytes,
-                              stats.aggregatedTxStats.bytesPerSec, stats.aggregatedTxStats.bytesPerSec / 1.25e+8);
-
-
-            ss << "getAmountOfFreeMbufs()=" << device->getAmountOfFreeMbufs() << " getAmountOfMbufsInUse()=" << device->getAmountOfMbufsInUse() << '\n';
-            ss << "rxPacketsDroppedByHW=" << stats.rxPacketsDroppedByHW << " rxErroneousPackets=" << stats.rxErroneousPackets << " rxMbufAlocFailed=" << stats.rxMbufAlocFailed << " txFailedPackets=" << stats.txFailedPackets << '\n';
+    // baseline for the rates, the first sample would report the counters since the port started otherwise
+    device->getStatistics(last_stats);
+    device->getExtendedStatistics(xstats);
+    for (auto& [name, value] : xstats) {
+        last_xstats[name] = value;
+    }
 
-            std::cout << ss.str() << std::flush;
-        }
-    });
+    if constexpr (ENABLED_STATS & StatsBitmask::PERIODIC) {
+        stats::StatsCollector::get().reg(this, [this](auto& samples) {
+            sample_stats(samples);
+        });
+    }
 }
 
 
 DPDKCommunicator::~DPDKCommunicator() {
-    // if (stats_thread.joinable()) {
-    //     stats_thread.join();
-    // }
+    if constexpr (ENABLED_STATS & StatsBitmask::PERIODIC) {
+        stats::StatsCollector::get().dereg(static_cast<const void*>(this));
+    }
     auto& dpdk = Dpdk::getInstance();
     dpdk.stopDpdkWorkerThreads();
 }
@@ -126,12 +114,69 @@ void DPDKCommunicator::send(msg::node_t target, DPDKPacketBuffer*& pkt, uint32_t
 
 
     uint16_t tx_queue = static_cast<uint16_t>(tid);
-    bool success = device->send(pkt, tx_queue);
+    auto& buf = tx_buffers[tx_queue];
+    buf.pkts[buf.size++] = pkt;
+    pkt = nullptr;
+    if (!buf.batching || buf.size == MAX_TX_BURST) {
+        flush(buf, tx_queue);
+    }
+}
 
-    if (!success) {
-        throw std::runtime_error("Failed to send");
+
+void DPDKCommunicator::begin_batch(uint32_t tid) {
+    tx_buffers[tid].batching = true;
+}
+
+void DPDKCommunicator::end_batch(uint32_t tid) {
+    auto& buf = tx_buffers[tid];
+    buf.batching = false;
+    flush(buf, static_cast<uint16_t>(tid));
+}
+
+
+void DPDKCommunicator::flush(TxBuffer& buf, uint16_t tx_queue) {
+    if (buf.size == 0) {
+        return;
+    }
+    device->send_many(buf.pkts.data(), buf.size, tx_queue); // retries until the NIC took all
+    buf.size = 0;
+}
+
+
+// Counters are reported per second like the periodic counters, pool
+// occupancy as absolute number of mbufs. xstats only if they changed.
+void DPDKCommunicator::sample_stats(std::vector<std::pair<std::string, uint64_t>>& samples) {
+    constexpr uint64_t per_sec = 1s / STATS_PERIODIC_SAMPLE_TIME;
+
+    DpdkDevice::DpdkDeviceStats stats;
+    device->getStatistics(stats);
+
+    samples.emplace_back("nic_rx_pkts", stats.aggregatedRxStats.packetsPerSec);
+    samples.emplace_back("nic_tx_pkts", stats.aggregatedTxStats.packetsPerSec);
+    samples.emplace_back("nic_rx_bytes", stats.aggregatedRxStats.bytesPerSec);
+    samples.emplace_back("nic_tx_bytes", stats.aggregatedTxStats.bytesPerSec);
+    samples.emplace_back("nic_rx_dropped_hw", (stats.rxPacketsDroppedByHW - last_stats.rxPacketsDroppedByHW) * per_sec);
+    samples.emplace_back("nic_rx_errors", (stats.rxErroneousPackets - last_stats.rxErroneousPackets) * per_sec);
+    samples.emplace_back("nic_rx_nombuf", (stats.rxMbufAlocFailed - last_stats.rxMbufAlocFailed) * per_sec);
+    samples.emplace_back("nic_tx_failed", (stats.txFailedPackets - last_stats.txFailedPackets) * per_sec);
+    for (uint16_t q = 0; q < std::min<uint16_t>(num_tx_queues, RTE_ETHDEV_QUEUE_STAT_CNTRS); ++q) {
+        samples.emplace_back(fmt::format("nic_tx_q{}_pkts", q), stats.txStats[q].packetsPerSec);
+    }
+    for (uint16_t q = 0; q < std::min<uint16_t>(num_rx_queues, RTE_ETHDEV_QUEUE_STAT_CNTRS); ++q) {
+        samples.emplace_back(fmt::format("nic_rx_q{}_pkts", q), stats.rxStats[q].packetsPerSec);
+    }
+    samples.emplace_back("mbufs_free", device->getAmountOfFreeMbufs());
+    samples.emplace_back("mbufs_in_use", device->getAmountOfMbufsInUse());
+    last_stats = stats;
+
+    device->getExtendedStatistics(xstats);
+    for (auto& [name, value] : xstats) {
+        auto& last = last_xstats[name];
+        if (value != last) {
+            samples.emplace_back("xstat_" + name, (value - last) * per_sec);
+            last = value;
+        }
     }
-    pkt = nullptr;
 }
 
 
@@ -140,6 +185,34 @@ DPDKPacketBuffer* DPDKCommunicator::make_pkt() {
 }
 
 
+void* DPDKCommunicator::alloc_dma(std::size_t size) {
+    void* memory = rte_malloc("p4db_rows", size, RTE_CACHE_LINE_SIZE);
+    if (!memory) {
+        throw std::bad_alloc();
+    }
+    return memory;
+}
+
+
+void DPDKCommunicator::free_dma(void* memory) {
+    rte_free(memory);
+}
+
+
+bool DPDKCommunicator::attach(DPDKPacketBuffer* pkt, const void* payload, uint16_t len) {
+    if (zero_copy_bytes == 0 || len < zero_copy_bytes) {
+        return false;
+    }
+    auto bytes = static_cast<const uint8_t*>(payload);
+    rte_iova_t iova = rte_mem_virt2iova(bytes);
+    if (iova == RTE_BAD_IOVA || rte_mem_virt2iova(bytes + len - 1) != iova + len - 1) {
+        return false; // not dpdk memory, or spans pages that are not iova-contiguous
+    }
+    pkt->attach(device->allocate(), const_cast<uint8_t*>(bytes), iova, len);
+    return true;
+}
+
+
 bool ReceiverThread::run(uint32_t core_id) {
     const WorkerContext::guard worker_ctx;
     WorkerContext::get().tid = mh_tid;
@@ -148,9 +221,14 @@ bool ReceiverThread::run(uint32_t core_id) {
     DPDKPacket* pkts[MAX_RECEIVE_BURST];
 
     while (!do_stop) {
+        WorkerContext::get().refresh_stats();
         for (uint16_t rx_queue = 0; rx_queue < rx_queues; ++rx_queue) {
             uint16_t nb_pkts = device->receive(pkts, MAX_RECEIVE_BURST, rx_queue);
+            if (nb_pkts == 0) {
+                continue;
+            }
 
+            const TxBatch replies{handler->comm, mh_tid};
             for (uint16_t i = 0; i < nb_pkts; ++i) {
                 auto pkt = static_cast<DPDKPacketBuffer*>(pkts[i]);
                 handler->handle(pkt);
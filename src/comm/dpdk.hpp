@@ -9,11 +9,17 @@
 #include "server.hpp"
 
 #include <algorithm>
+#include <array>
 #include <cstdio>
 #include <cstring>
 #include <iostream>
+#include <memory>
 #include <mutex>
+#include <string>
 #include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
 
 
 struct MessageHandler;
@@ -70,7 +76,7 @@ struct DPDKPacketBuffer : public DPDKPacket {
 
     void dump(std::ostream& os) {
         auto bytes = data();
-        hex_dump(os, bytes, size());
+        hex_dump(os, bytes, head_size()); // without attached segments
     }
 
 private:
@@ -84,12 +90,23 @@ private:
 };
 
 
+constexpr size_t MAX_TX_BURST = 32;
+
+
 class DPDKCommunicator {
     // using lock_t = std::mutex;
     using lock_t = SpinLock;
 
     lock_t mutex;
 
+    // per tx-queue staging, handed to the NIC with one doorbell per burst
+    struct alignas(64) TxBuffer {
+        uint16_t size = 0;
+        bool batching = false;
+        std::array<DPDKPacket*, MAX_TX_BURST> pkts;
+    };
+    std::unique_ptr<TxBuffer[]> tx_buffers;
+
 public:
     using Pkt_t = DPDKPacketBuffer;
 
@@ -108,8 +125,13 @@ public:
     uint16_t num_tx_queues;
     uint32_t mh_tid;
     uint16_t spin_tx_queue;
+    uint32_t zero_copy_bytes;
     MessageHandler* handler = nullptr;
-    std::jthread stats_thread;
+
+    // previous NIC counters, to report them per second in the periodic csv
+    DpdkDevice::DpdkDeviceStats last_stats{};
+    std::unordered_map<std::string, uint64_t> last_xstats;
+    std::vector<std::pair<std::string, uint64_t>> xstats;
 
 public:
     DPDKCommunicator();
@@ -122,6 +144,18 @@ public:
     void send(msg::node_t target, DPDKPacketBuffer*& pkt, uint32_t tid);
 
     DPDKPacketBuffer* make_pkt();
+
+    void begin_batch(uint32_t tid);
+    void end_batch(uint32_t tid);
+
+    // --zero_copy_bytes: table rows in dpdk memory, chained to replies as is
+    void* alloc_dma(std::size_t size);
+    void free_dma(void* memory);
+    bool attach(DPDKPacketBuffer* pkt, const void* payload, uint16_t len);
+
+private:
+    void flush(TxBuffer& buf, uint16_t tx_queue);
+    void sample_stats(std::vector<std::pair<std::string, uint64_t>>& samples);
 };
 
 
@@ -0,0 +1,91 @@
+#include "reply_cache.hpp"
+
+#include "db/config.hpp"
+
+#include <cstring>
+#include <mutex>
+
+
+ReplyCache::ReplyCache() : enabled(Config::instance().msg_timeout_us > 0) {
+    if (enabled) {
+        index.reserve(CAPACITY);
+        slots.resize(CAPACITY);
+    }
+}
+
+
+ReplyCache::Verdict ReplyCache::on_request(Communicator::Pkt_t* pkt, Kind kind) {
+    if (!enabled) {
+        return Verdict::PROCESS;
+    }
+    auto msg = pkt->as<msg::Header>();
+    auto k = key(msg->sender, msg->msg_id, kind);
+
+    const std::lock_guard<SpinLock> lock(mutex);
+    auto it = index.find(k);
+    if (it == index.end()) {
+        insert(k, State::PENDING);
+        return Verdict::PROCESS;
+    }
+    auto& entry = slots[it->second];
+    if (entry.state != State::REPLIED) {
+        return Verdict::DROP;
+    }
+    pkt->resize(entry.reply.size());
+    std::memcpy(pkt->as<uint8_t>(), entry.reply.data(), entry.reply.size());
+    return Verdict::RESEND;
+}
+
+
+bool ReplyCache::record(msg::Header* reply, std::size_t size) {
+    auto kind = (reply->type == msg::Type::TUPLE_PUT_RES) ? Kind::PUT : Kind::GET; // TupleGetRes or TupleCallRes
+    auto k = key(reply->sender, reply->msg_id, kind);
+    auto bytes = reinterpret_cast<const uint8_t*>(reply);
+
+    const std::lock_guard<SpinLock> lock(mutex);
+    auto it = index.find(k);
+    auto& entry = (it == index.end()) ? insert(k, State::PENDING) : slots[it->second];
+    if (entry.state == State::CANCELLED) {
+        return false;
+    }
+    entry.state = State::REPLIED;
+    entry.reply.assign(bytes, bytes + size);
+    return true;
+}
+
+
+bool ReplyCache::cancel(msg::node_t node, msg::id_t msg_id, std::vector<uint8_t>& granted) {
+    if (!enabled) {
+        return false;
+    }
+    auto k = key(node, msg_id, Kind::GET);
+
+    const std::lock_guard<SpinLock> lock(mutex);
+    auto it = index.find(k);
+    if (it == index.end()) { // request lost or still on its way
+        insert(k, State::CANCELLED);
+        return false;
+    }
+    auto& entry = slots[it->second];
+    bool was_granted = entry.state == State::REPLIED &&
+                       reinterpret_cast<msg::TupleGetRes*>(entry.reply.data())->mode != AccessMode::INVALID;
+    if (was_granted) {
+        granted = entry.reply;
+    }
+    entry.state = State::CANCELLED;
+    return was_granted;
+}
+
+
+ReplyCache::Entry& ReplyCache::insert(uint64_t key, State state) {
+    auto& entry = slots[next_slot];
+    if (entry.key != ~0ull) {
+        index.erase(entry.key);
+    }
+    entry.key = key;
+    entry.state = state;
+    entry.reply.clear();
+    index[key] = next_slot;
+    next_slot = (next_slot + 1) & (CAPACITY - 1);
+    return entry;
+}
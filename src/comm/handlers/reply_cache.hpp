@@ -0,0 +1,71 @@
+#pragma once
+
+#include "comm/comm.hpp"
+#include "db/spinlock.hpp"
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+
+// Owner side of the retransmission protocol (see --msg_timeout_us). Requests
+// are identified by sender node, msg_id and kind, a resent request is answered
+// with the cached reply instead of being executed twice. A TupleGetReq that
+// still waits for its lock is PENDING, once the requester gave up it is
+// CANCELLED and never granted. Only the last CAPACITY requests are kept.
+struct ReplyCache {
+    static constexpr uint32_t CAPACITY = 65536; // power of 2
+
+    enum class Kind : uint64_t {
+        GET = 0,
+        PUT = 1,
+    };
+
+    enum class State : uint8_t {
+        PENDING,
+        REPLIED,
+        CANCELLED,
+    };
+
+    enum class Verdict {
+        PROCESS, // first copy of the request
+        RESEND,  // pkt now holds the cached reply
+        DROP,    // still in progress or cancelled
+    };
+
+    struct Entry {
+        uint64_t key = ~0ull;
+        State state;
+        std::vector<uint8_t> reply;
+    };
+
+    bool enabled;
+    SpinLock mutex;
+    std::unordered_map<uint64_t, uint32_t> index; // key -> slot
+    std::vector<Entry> slots;                     // fifo, the oldest entry is reused
+    uint32_t next_slot = 0;
+
+    ReplyCache();
+
+    static uint64_t key(msg::node_t node, msg::id_t msg_id, Kind kind) {
+        return msg_id.value << 9 | static_cast<uint64_t>(static_cast<uint32_t>(node)) << 1 | static_cast<uint64_t>(kind);
+    }
+
+    Verdict on_request(Communicator::Pkt_t* pkt, Kind kind);
+
+    // before a reply leaves, false if the requester cancelled meanwhile
+    bool record(msg::Header* reply, std::size_t size);
+
+    // requester gave up on a lock request, returns true and the reply if it was granted
+    bool cancel(msg::node_t node, msg::id_t msg_id, std::vector<uint8_t>& granted);
+
+private:
+    Entry& insert(uint64_t key, State state);
+};
+
+
+// Used by the concurrency control schemes for every TupleGetRes, they only see
+// the communicator. record_reply fails if the request was cancelled, in which
+// case no lock must be granted; send_reply then frees pkt instead.
+bool record_reply(Communicator& comm, Communicator::Pkt_t* pkt);
+bool send_reply(Communicator& comm, Communicator::Pkt_t*& pkt, uint32_t tid);
@@ -0,0 +1,21 @@
+#include "tuple_call.hpp"
+
+#include <mutex>
+
+
+void TupleCallHandler::keep(msg::Header* call, const void* tuple, std::size_t size) {
+    auto bytes = static_cast<const uint8_t*>(tuple);
+    const std::lock_guard<SpinLock> lock(mutex);
+    undo[key(call)].assign(bytes, bytes + size);
+}
+
+bool TupleCallHandler::take(msg::Header* msg, std::vector<uint8_t>& before) {
+    const std::lock_guard<SpinLock> lock(mutex);
+    auto it = undo.find(key(msg));
+    if (it == undo.end()) {
+        return false;
+    }
+    before = std::move(it->second);
+    undo.erase(it);
+    return true;
+}
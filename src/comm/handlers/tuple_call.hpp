@@ -0,0 +1,28 @@
+#pragma once
+
+#include "comm/comm.hpp"
+#include "db/spinlock.hpp"
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+
+// Owner side of function shipping: the tuples from before every write
+// fragment that still holds its lock, restored if the txn aborts.
+struct TupleCallHandler {
+    SpinLock mutex;
+    std::unordered_map<uint64_t, std::vector<uint8_t>> undo; // by requester node and msg_id
+
+    static uint64_t key(msg::Header* msg) {
+        return msg->msg_id.value << 8 | static_cast<uint32_t>(msg->sender);
+    }
+
+    void keep(msg::Header* call, const void* tuple, std::size_t size);
+    bool take(msg::Header* msg, std::vector<uint8_t>& before);
+};
+
+
+// Used by the concurrency control schemes, like send_reply.
+void keep_undo(Communicator& comm, msg::Header* call, const void* tuple, std::size_t size);
+void drop_undo(Communicator& comm, msg::Header* call);
@@ -1,23 +1,149 @@
 #include "tuple_put_res.hpp"
 
 #include "db/config.hpp"
+#include "stats/context.hpp"
 
+#include <cstring>
 
-TuplePutResHandler::TuplePutResHandler() : counts(Config::instance().num_txn_workers) {}
 
+TuplePutResHandler::TuplePutResHandler(Communicator* comm)
+    : comm(comm), timeout(Config::instance().msg_timeout_us), async(Config::instance().async_commit),
+      tracked(timeout.count() > 0 || async), counts(Config::instance().num_txn_workers) {
+    if (tracked) {
+        for (auto& c : counts) {
+            c.outstanding = std::make_unique<Outstanding[]>(MAX_OUTSTANDING);
+        }
+    }
+}
 
-void TuplePutResHandler::add(size_t index) {
-    counts[index].incr();
+
+// Called before the put is sent, the copy is published before a reply can arrive.
+void TuplePutResHandler::add(size_t index, msg::node_t target, Communicator::Pkt_t* pkt, std::size_t size) {
+    auto& c = counts[index];
+    if (tracked) {
+        auto n = c.num_outstanding.load(std::memory_order_relaxed);
+        if (n == MAX_OUTSTANDING) {
+            throw std::runtime_error("too many outstanding remote puts");
+        }
+        auto& put = c.outstanding[n];
+        auto req = pkt->as<msg::TuplePutReq>(); // same header for TupleReleaseReq
+        put.msg_id.store(req->msg_id, std::memory_order_relaxed);
+        put.acked.store(false, std::memory_order_relaxed);
+        put.target = target;
+        put.row = row_id(req->tid, req->rid);
+        if (timeout.count() > 0) {
+            auto bytes = pkt->as<uint8_t>();
+            put.bytes.assign(bytes, bytes + size);
+            if (n == 0) {
+                c.resend_at = std::chrono::steady_clock::now() + timeout;
+            }
+        }
+        c.num_outstanding.store(n + 1, std::memory_order_release);
+    }
+    c.incr();
 }
 
-void TuplePutResHandler::handle(msg::node_t node) {
-    counts[node.get_tid()].decr();
+void TuplePutResHandler::handle(msg::TuplePutRes* res) {
+    auto& c = counts[res->sender.get_tid()];
+    if (!tracked) {
+        c.decr();
+        return;
+    }
+
+    auto n = c.num_outstanding.load(std::memory_order_acquire);
+    for (uint32_t i = 0; i < n; ++i) {
+        auto& put = c.outstanding[i];
+        if (put.msg_id.load(std::memory_order_relaxed) != res->msg_id) {
+            continue;
+        }
+        if (!put.acked.exchange(true)) {
+            c.decr();
+            return;
+        }
+        break;
+    }
+    WorkerContext::get().cntr.incr(stats::Counter::msg_duplicates); // resent put or previous txn
 }
 
+// Releases cannot be aborted, unacknowledged puts are resent until they arrive.
 void TuplePutResHandler::wait(size_t index) {
-    counts[index].wait_zero();
+    auto& c = counts[index];
+    if (timeout.count() == 0) {
+        c.wait_zero();
+        c.num_outstanding.store(0, std::memory_order_relaxed);
+        return;
+    }
+
+    auto deadline = std::chrono::steady_clock::now() + timeout;
+    while (c.cnt.load(std::memory_order_relaxed) != 0) {
+        if (std::chrono::steady_clock::now() >= deadline) [[unlikely]] {
+            resend(index);
+            deadline = std::chrono::steady_clock::now() + timeout;
+        }
+        __builtin_ia32_pause();
+    }
+    c.num_outstanding.store(0, std::memory_order_relaxed);
+}
+
+
+// Acknowledged slots are reused once nothing is outstanding, the worker only
+// waits if it runs out of them. Puts are resent here as the worker does not
+// wait for them.
+void TuplePutResHandler::make_room(size_t index, size_t n) {
+    auto& c = counts[index];
+    if (c.cnt.load(std::memory_order_relaxed) == 0) {
+        c.num_outstanding.store(0, std::memory_order_relaxed);
+        return;
+    }
+    if (c.num_outstanding.load(std::memory_order_relaxed) + n > MAX_OUTSTANDING) {
+        wait(index);
+        return;
+    }
+    if (timeout.count() > 0 && std::chrono::steady_clock::now() >= c.resend_at) [[unlikely]] {
+        resend(index);
+        c.resend_at = std::chrono::steady_clock::now() + timeout;
+    }
 }
 
+// Messages of a worker may overtake each other (resends, the switch), so a
+// request could reach the owner before the release of the same row and be
+// refused by our own previous txn. Waits for all outstanding puts then, they
+// were sent together anyway.
+void TuplePutResHandler::wait_row(size_t index, p4db::table_t table, p4db::key_t key) {
+    auto& c = counts[index];
+    if (!async || c.cnt.load(std::memory_order_relaxed) == 0) [[likely]] {
+        return;
+    }
+    const auto row = row_id(table, key);
+    auto n = c.num_outstanding.load(std::memory_order_relaxed);
+    for (uint32_t i = 0; i < n; ++i) {
+        auto& put = c.outstanding[i];
+        if (put.row == row && !put.acked.load(std::memory_order_relaxed)) {
+            WorkerContext::get().cntr.incr(stats::Counter::put_row_waits);
+            wait(index);
+            return;
+        }
+    }
+}
+
+
+void TuplePutResHandler::resend(size_t index) {
+    auto& c = counts[index];
+    auto n = c.num_outstanding.load(std::memory_order_relaxed);
+    for (uint32_t i = 0; i < n; ++i) {
+        auto& put = c.outstanding[i];
+        if (put.acked.load(std::memory_order_relaxed)) {
+            continue;
+        }
+        auto pkt = comm->make_pkt();
+        pkt->resize(put.bytes.size());
+        std::memcpy(pkt->as<uint8_t>(), put.bytes.data(), put.bytes.size());
+        comm->send(put.target, pkt, index);
+        WorkerContext::get().cntr.incr(stats::Counter::msg_retransmits);
+    }
+}
+
+
 void TuplePutResHandler::Counter::incr() {
     cnt.fetch_add(1);
 }
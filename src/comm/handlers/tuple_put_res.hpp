@@ -3,21 +3,57 @@
 
 #include "comm/comm.hpp"
 
+#include <atomic>
+#include <chrono>
+#include <memory>
 #include <vector>
 
 
+// Counts the remote puts and releases of each worker until they are
+// acknowledged. With --async_commit a txn does not wait for them, the next
+// one only blocks if it requests a row that is still being released.
 struct TuplePutResHandler {
+    static constexpr uint32_t MAX_OUTSTANDING = 1024; // remote puts per worker and txn
+
+    // sent put, tracked if --msg_timeout_us (a copy to resend) or --async_commit is set
+    struct Outstanding {
+        std::atomic<msg::id_t::type> msg_id{};
+        std::atomic<bool> acked{};
+        msg::node_t target;
+        uint64_t row; // see row_id
+        std::vector<uint8_t> bytes;
+    };
+
     struct Counter {
         alignas(64) std::atomic<uint64_t> cnt{};
+        std::atomic<uint32_t> num_outstanding{};
+        std::unique_ptr<Outstanding[]> outstanding;
+        std::chrono::steady_clock::time_point resend_at; // async_commit
         void incr();
         void decr();
         void wait_zero();
     };
+    Communicator* comm;
+    std::chrono::microseconds timeout;
+    bool async;
+    bool tracked;
     std::vector<Counter> counts;
 
-    TuplePutResHandler();
+    TuplePutResHandler(Communicator* comm);
 
-    void add(size_t index);
-    void handle(msg::node_t node);
+    static uint64_t row_id(p4db::table_t table, p4db::key_t key) {
+        return static_cast<uint64_t>(table) << 48 | key;
+    }
+
+    void add(size_t index, msg::node_t target, Communicator::Pkt_t* pkt, std::size_t size);
+    void handle(msg::TuplePutRes* res);
     void wait(size_t index);
+
+    // async_commit: before a commit adds up to n puts
+    void make_room(size_t index, size_t n);
+    // async_commit: before a lock request, waits if the row is still being released
+    void wait_row(size_t index, p4db::table_t table, p4db::key_t key);
+
+private:
+    void resend(size_t index);
 };
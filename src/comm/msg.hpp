@@ -4,33 +4,41 @@
 #include "db/util.hpp"
 
 #include <cstdint>
+#include <type_traits>
 
 
 namespace msg {
 
+// Wire format of all messages. The high nibble is the version, bumped on
+// every layout change, bit 0 tells whether tuple messages carry a timestamp,
+// only WAIT_DIE orders txns by them. Switch parsers select on both.
+static constexpr uint8_t WIRE_VERSION = 2;
+static constexpr bool WIRE_TS = CC_SCHEME == CC_Scheme::WAIT_DIE;
+static constexpr uint8_t WIRE_FORMAT = WIRE_VERSION << 4 | WIRE_TS;
+
 struct node_t {
-    uint32_t value; // thread << 24 | node
+    uint16_t value; // thread << 8 | node
 
     node_t() = default;
 
     constexpr node_t(uint32_t nid)
-        : value(nid) {}
+        : value(static_cast<uint16_t>(nid)) {}
 
     constexpr node_t(uint32_t nid, uint32_t tid)
-        : value(tid << 8 | (nid & 0xff)) {}
+        : value(static_cast<uint16_t>(tid << 8 | (nid & 0xff))) {}
 
     uint32_t get_tid() const {
         return value >> 8;
     }
 
     operator uint32_t() const {
-        return value & 0x000000ff;
+        return value & 0x00ff;
     }
 };
 
 
 struct id_t {
-    using type = uint64_t;
+    using type = uint32_t; // wraps, only needs to be unique among open requests
 
     type value;
     operator type() const {
@@ -44,20 +52,25 @@ struct id_t {
     };
 };
 
-enum class Type : uint32_t {
-    INIT = 0x00010001,
-    BARRIER = 0x00010002,
+enum class Type : uint8_t {
+    INIT = 0x81,
+    BARRIER = 0x82,
+
+    TUPLE_GET_REQ = 0x01,
+    TUPLE_GET_RES = 0x02,
+    TUPLE_PUT_REQ = 0x03,
+    TUPLE_PUT_RES = 0x04,
 
-    TUPLE_GET_REQ = 0x00000001,
-    TUPLE_GET_RES = 0x00000002,
-    TUPLE_PUT_REQ = 0x00000003,
-    TUPLE_PUT_RES = 0x00000004,
+    SWITCH_TXN = 0x05,
 
-    SWITCH_TXN = 0x00000005,
+    TUPLE_CALL_REQ = 0x06,
+    TUPLE_CALL_RES = 0x07,
+    TUPLE_RELEASE_REQ = 0x08,
 };
 
 struct Header {
     Type type;
+    uint8_t format = WIRE_FORMAT;
     node_t sender;
     id_t msg_id; // match msg future with reply
 
@@ -74,6 +87,7 @@ struct Header {
         return reinterpret_cast<T*>(this);
     }
 };
+static_assert(sizeof(Header) == 8);
 
 template <typename T, Type TYPE>
 struct Base : crtp<T>, public Header {
@@ -92,13 +106,80 @@ struct Init : public Base<Init, Type::INIT> {};
 struct Barrier : public Base<Barrier, Type::BARRIER> {};
 
 
-// used by all 4 tuple interaction messages
+// Field types of TupleMsgHeader, they convert from and to the in-memory types.
+namespace wire {
+
+struct table_t {
+    uint16_t value;
+
+    table_t() = default;
+    constexpr table_t(p4db::table_t tid) : value(static_cast<uint16_t>(tid.value)) {}
+
+    operator p4db::table_t() const {
+        return p4db::table_t{value};
+    }
+
+    operator uint64_t() const {
+        return value;
+    }
+};
+
+struct key_t { // 48 bit
+    uint16_t parts[3];
+
+    key_t() = default;
+    constexpr key_t(p4db::key_t rid)
+        : parts{static_cast<uint16_t>(rid.value), static_cast<uint16_t>(rid.value >> 16), static_cast<uint16_t>(rid.value >> 32)} {}
+
+    operator uint64_t() const {
+        return uint64_t{parts[2]} << 32 | uint64_t{parts[1]} << 16 | parts[0];
+    }
+
+    operator p4db::key_t() const {
+        return p4db::key_t{static_cast<uint64_t>(*this)};
+    }
+};
+
+struct timestamp_t { // two words, TupleMsgHeader stays 4 byte aligned
+    uint32_t lo;
+    uint32_t hi;
+
+    timestamp_t() = default;
+    constexpr timestamp_t(::timestamp_t ts) : lo(static_cast<uint32_t>(ts.value)), hi(static_cast<uint32_t>(ts.value >> 32)) {}
+
+    operator ::timestamp_t() const {
+        return ::timestamp_t{uint64_t{hi} << 32 | lo};
+    }
+};
+
+struct no_timestamp_t { // not sent, reads as 0
+    no_timestamp_t() = default;
+    constexpr no_timestamp_t(::timestamp_t) {}
+
+    operator ::timestamp_t() const {
+        return ::timestamp_t{0};
+    }
+};
+
+static constexpr uint64_t MAX_KEYS = uint64_t{1} << 48;
+static constexpr uint64_t MAX_TABLES = uint64_t{1} << 16;
+static constexpr std::size_t MAX_MSG_SIZE = 1500; // one MTU, messages are never fragmented
+
+} // namespace wire
+
+
+// used by all tuple interaction messages, 12 bytes plus 8 with WIRE_TS
 struct TupleMsgHeader {
-    timestamp_t ts;
-    p4db::table_t tid;
-    p4db::key_t rid;
-    AccessMode mode;
+    wire::table_t tid;
+    wire::key_t rid;
+    AccessMode mode; // switch lock manager reads the lock index from its upper bytes
+    [[no_unique_address]] std::conditional_t<WIRE_TS, wire::timestamp_t, wire::no_timestamp_t> ts;
+
+    TupleMsgHeader() = default;
+    TupleMsgHeader(timestamp_t ts, p4db::table_t tid, p4db::key_t rid, AccessMode mode)
+        : tid(tid), rid(rid), mode(mode), ts(ts) {}
 };
+static_assert(sizeof(TupleMsgHeader) == (WIRE_TS ? 20 : 12));
 
 struct TupleGetReq : public Base<TupleGetReq, Type::TUPLE_GET_REQ>, public TupleMsgHeader {
     TupleGetReq(timestamp_t ts, p4db::table_t tid, p4db::key_t rid, AccessMode mode)
@@ -109,7 +190,7 @@ struct TupleGetReq : public Base<TupleGetReq, Type::TUPLE_GET_REQ>, public Tuple
 struct TupleGetRes : public Base<TupleGetRes, Type::TUPLE_GET_RES>, public TupleMsgHeader {
 #pragma GCC diagnostic push
 #pragma GCC diagnostic ignored "-Wpedantic"
-    uint8_t tuple[0];
+    alignas(8) uint8_t tuple[0]; // tuples are read in place
 #pragma GCC diagnostic pop
 
     TupleGetRes(timestamp_t ts, p4db::table_t tid, p4db::key_t rid, AccessMode mode)
@@ -124,7 +205,7 @@ struct TupleGetRes : public Base<TupleGetRes, Type::TUPLE_GET_RES>, public Tuple
 struct TuplePutReq : public Base<TuplePutReq, Type::TUPLE_PUT_REQ>, public TupleMsgHeader {
 #pragma GCC diagnostic push
 #pragma GCC diagnostic ignored "-Wpedantic"
-    uint8_t tuple[0];
+    alignas(8) uint8_t tuple[0];
 #pragma GCC diagnostic pop
 
     TuplePutReq(timestamp_t ts, p4db::table_t tid, p4db::key_t rid, AccessMode mode)
@@ -143,6 +224,48 @@ struct TuplePutRes : public Base<TuplePutRes, Type::TUPLE_PUT_RES>, public Tuple
 };
 
 
+// Function shipping: locks the tuple like a TupleGetReq, runs the registered
+// fragment proc on it at the owner and returns only the fragment's result.
+struct TupleCallReq : public Base<TupleCallReq, Type::TUPLE_CALL_REQ>, public TupleMsgHeader {
+    uint16_t proc;
+    bool autocommit; // lock is released right after the fragment, no TupleReleaseReq follows
+    bool applied;    // only used by TupleCallRes
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wpedantic"
+    alignas(8) uint8_t args[0];
+#pragma GCC diagnostic pop
+
+    TupleCallReq(timestamp_t ts, p4db::table_t tid, p4db::key_t rid, AccessMode mode, uint16_t proc, bool autocommit)
+        : TupleMsgHeader{ts, tid, rid, mode}, proc(proc), autocommit(autocommit), applied(false) {}
+
+    static constexpr auto size(size_t args_size) {
+        return sizeof(TupleCallReq) + args_size;
+    }
+};
+
+struct TupleCallRes : public Base<TupleCallRes, Type::TUPLE_CALL_RES>, public TupleMsgHeader {
+    uint16_t proc;
+    bool autocommit;
+    bool applied; // false if the fragment refused, the lock is released then
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wpedantic"
+    alignas(8) uint8_t result[0];
+#pragma GCC diagnostic pop
+
+    static constexpr auto size(size_t result_size) {
+        return sizeof(TupleCallRes) + result_size;
+    }
+};
+
+// Ends a TupleCallReq that kept its lock, answered with a TuplePutRes.
+struct TupleReleaseReq : public Base<TupleReleaseReq, Type::TUPLE_RELEASE_REQ>, public TupleMsgHeader {
+    bool commit; // else the owner restores the tuple from before the fragment
+
+    TupleReleaseReq(timestamp_t ts, p4db::table_t tid, p4db::key_t rid, AccessMode mode, bool commit)
+        : TupleMsgHeader{ts, tid, rid, mode}, commit(commit) {}
+};
+
+
 struct SwitchTxn : public Base<SwitchTxn, Type::SWITCH_TXN> {
     SwitchTxn() = default;
 
@@ -2,10 +2,15 @@
 
 #include "db/config.hpp"
 #include "db/database.hpp"
+#include "db/ts_factory.hpp"
+
+#include <cstring>
+#include <sstream>
 
 
 MessageHandler::MessageHandler(Database& db, Communicator* comm)
-    : db(db), comm(comm), tid(comm->mh_tid), init(comm), barrier(comm) {
+    : db(db), comm(comm), tid(comm->mh_tid), init(comm), barrier(comm), putresponses(comm),
+      drop_rng(Config::instance().node_id + 1), drop(Config::instance().drop_rate) {
     comm->set_handler(this);
 }
 
@@ -19,6 +24,35 @@ void MessageHandler::add_future(msg::id_t msg_id, AbstractFuture* future) {
 }
 
 
+std::size_t MessageHandler::reply_size(msg::Header* reply) {
+    if (reply->type == msg::Type::TUPLE_PUT_RES) {
+        return sizeof(msg::TuplePutRes);
+    }
+    if (reply->type == msg::Type::TUPLE_CALL_RES) {
+        auto res = reply->as<msg::TupleCallRes>();
+        if (res->mode == AccessMode::INVALID) {
+            return msg::TupleCallRes::size(0);
+        }
+        return msg::TupleCallRes::size(fragments::Registry::get().at(res->proc).result_size);
+    }
+    auto res = reply->as<msg::TupleGetRes>();
+    if (res->mode == AccessMode::INVALID) {
+        return sizeof(msg::TupleGetRes);
+    }
+    return msg::TupleGetRes::size(db[res->tid]->tuple_size());
+}
+
+
+void MessageHandler::cancel(msg::node_t target, msg::id_t msg_id, const msg::TupleMsgHeader& req, uint32_t worker_tid) {
+    auto pkt = comm->make_pkt();
+    auto put = pkt->ctor<msg::TuplePutReq>(req.ts, req.tid, req.rid, AccessMode::INVALID);
+    put->sender = msg::node_t{comm->node_id, worker_tid};
+    put->msg_id = msg_id; // names the TupleGetReq or TupleCallReq to cancel
+    putresponses.add(worker_tid, target, pkt, msg::TuplePutReq::size(0));
+    comm->send(target, pkt, worker_tid);
+}
+
+
 void MessageHandler::handle(Pkt_t* pkt) {
     using namespace msg;
 
@@ -29,6 +63,20 @@ void MessageHandler::handle(Pkt_t* pkt) {
         pkt->dump(std::cout);
     }
 
+    if (msg->format != msg::WIRE_FORMAT) [[unlikely]] { // other build, e.g. another cc_scheme
+        std::stringstream ss;
+        ss << "Received wire format 0x" << std::hex << +msg->format << " from node " << std::dec << msg->sender
+           << ", expected 0x" << std::hex << +msg::WIRE_FORMAT;
+        pkt->free();
+        throw std::runtime_error(ss.str());
+    }
+
+    if (inject_drop(msg->type)) [[unlikely]] {
+        WorkerContext::get().cntr.incr(stats::Counter::msg_dropped);
+        pkt->free();
+        return;
+    }
+
     switch (msg->type) {
         case Type::INIT:
             return handle(pkt, msg->as<msg::Init>());
@@ -46,12 +94,74 @@ void MessageHandler::handle(Pkt_t* pkt) {
 
         case Type::SWITCH_TXN:
             return handle(pkt, msg->as<msg::SwitchTxn>());
+
+        case Type::TUPLE_CALL_REQ:
+            return handle(pkt, msg->as<msg::TupleCallReq>());
+        case Type::TUPLE_CALL_RES:
+            return handle(pkt, msg->as<msg::TupleCallRes>());
+        case Type::TUPLE_RELEASE_REQ:
+            return handle(pkt, msg->as<msg::TupleReleaseReq>());
     }
 }
 
 
 // Private methods
 
+// Switch txns are not resent (not idempotent on the switch), so only the
+// tuple messages are dropped.
+bool MessageHandler::inject_drop(msg::Type type) {
+    if (drop.p() == 0.0) [[likely]] {
+        return false;
+    }
+    switch (type) {
+        case msg::Type::TUPLE_GET_REQ:
+        case msg::Type::TUPLE_GET_RES:
+        case msg::Type::TUPLE_PUT_REQ:
+        case msg::Type::TUPLE_PUT_RES:
+        case msg::Type::TUPLE_CALL_REQ:
+        case msg::Type::TUPLE_CALL_RES:
+        case msg::Type::TUPLE_RELEASE_REQ:
+            return drop(drop_rng);
+        default:
+            return false;
+    }
+}
+
+// Duplicate suppression, false if pkt was already answered from the ReplyCache.
+bool MessageHandler::first_copy(Pkt_t* pkt, ReplyCache::Kind kind) {
+    switch (replies.on_request(pkt, kind)) {
+        case ReplyCache::Verdict::PROCESS:
+            return true;
+        case ReplyCache::Verdict::RESEND:
+            WorkerContext::get().cntr.incr(stats::Counter::msg_duplicates);
+            comm->send(pkt->as<msg::Header>()->sender, pkt, tid);
+            return false;
+        case ReplyCache::Verdict::DROP:
+            WorkerContext::get().cntr.incr(stats::Counter::msg_duplicates);
+            pkt->free();
+            return false;
+    }
+    return false;
+}
+
+void MessageHandler::deliver(Pkt_t* pkt, msg::id_t msg_id) {
+    AbstractFuture* future = nullptr;
+    try {
+        future = open_futures.erase(msg_id);
+    } catch (...) {
+        if (!replies.enabled) {
+            std::cerr << "Received msg_id=" << msg_id << " without future.\n";
+            pkt->free();
+            throw;
+        }
+    }
+    if (!future) { // reply to a resent request, or the requester gave up
+        WorkerContext::get().cntr.incr(stats::Counter::msg_duplicates);
+        return pkt->free();
+    }
+    future->set_pkt(pkt);
+}
+
 void MessageHandler::handle(Pkt_t* pkt, msg::Init* msg) {
     std::cout << "Received msg::Init from " << msg->sender << '\n';
     init.handle(msg->sender);
@@ -67,6 +177,14 @@ void MessageHandler::handle(Pkt_t* pkt, msg::Barrier* msg) {
 void MessageHandler::handle(Pkt_t* pkt, msg::TupleGetReq* req) {
     // std::cerr << "msg::TupleGetReq tid=" << req->tid << " rid=" << req->rid << " mode=" << static_cast<int>(req->mode) << '\n';
 
+    if (!first_copy(pkt, ReplyCache::Kind::GET)) {
+        return;
+    }
+    if constexpr (std::is_same_v<TimestampFactory, LogicalTimestampFactory>) {
+        LogicalTimestampFactory::observe(req->ts);
+    }
+
+    auto span = WorkerContext::get().trace.scope(stats::Trace::handle_get_req, req->tid);
     auto table = db[req->tid];
     table->remote_get(pkt, req);
 }
@@ -74,38 +192,91 @@ void MessageHandler::handle(Pkt_t* pkt, msg::TupleGetReq* req) {
 void MessageHandler::handle(Pkt_t* pkt, msg::TupleGetRes* res) {
     // std::cerr << "msg::TupleGetRes tid=" << res->tid << " rid=" << res->rid << " mode=" << static_cast<int>(res->mode) << '\n';
 
-    try {
-        auto future = open_futures.erase(res->msg_id);
-        future->set_pkt(pkt);
-    } catch (...) {
-        std::cerr << "Received msg_id=" << res->msg_id << " without future.\n";
-        pkt->free();
-        throw;
-    }
+    WorkerContext::get().trace.instant(stats::Trace::handle_get_res, res->sender);
+    deliver(pkt, res->msg_id);
     // don't cleanup message buffer, will be cleaned up in undo-log
 }
 
+void MessageHandler::handle(Pkt_t* pkt, msg::TupleCallReq* req) {
+    if (!first_copy(pkt, ReplyCache::Kind::GET)) {
+        return;
+    }
+    if constexpr (std::is_same_v<TimestampFactory, LogicalTimestampFactory>) {
+        LogicalTimestampFactory::observe(req->ts);
+    }
+
+    auto span = WorkerContext::get().trace.scope(stats::Trace::handle_get_req, req->tid);
+    auto table = db[req->tid];
+    table->remote_get(pkt, req);
+}
+
+void MessageHandler::handle(Pkt_t* pkt, msg::TupleCallRes* res) {
+    WorkerContext::get().trace.instant(stats::Trace::handle_get_res, res->sender);
+    deliver(pkt, res->msg_id); // freed by the undo-log as well
+}
+
 void MessageHandler::handle(Pkt_t* pkt, msg::TuplePutReq* req) {
     // std::cerr << "msg::TuplePutReq tid=" << req->tid << " rid=" << req->rid << " mode=" << static_cast<int>(req->mode) << '\n';
+    if (!first_copy(pkt, ReplyCache::Kind::PUT)) {
+        return;
+    }
+
+    auto span = WorkerContext::get().trace.scope(stats::Trace::handle_put_req, req->tid);
     auto table = db[req->tid];
-    table->remote_put(req);
+    if (req->mode != AccessMode::INVALID) [[likely]] {
+        table->remote_put(req);
+    } else if (std::vector<uint8_t> granted; replies.cancel(req->sender, req->msg_id, granted)) {
+        auto grant = reinterpret_cast<msg::TupleGetRes*>(granted.data());
+        if (grant->type == msg::Type::TUPLE_GET_RES) {
+            // release the lock with the cached grant, its tuple is still unmodified
+            auto sender = req->sender;
+            pkt->resize(granted.size());
+            std::memcpy(pkt->as<uint8_t>(), granted.data(), granted.size());
+            req = pkt->as<msg::TupleGetRes>()->convert<msg::TuplePutReq>();
+            req->sender = sender;
+            table->remote_put(req);
+        } else if (auto call = reinterpret_cast<msg::TupleCallRes*>(grant); call->applied && !call->autocommit) {
+            // undo the fragment, autocommit calls are never cancelled (see await_remote)
+            msg::TupleReleaseReq release{call->ts, call->tid, call->rid, call->mode, false};
+            release.sender = req->sender;
+            release.msg_id = req->msg_id;
+            std::vector<uint8_t> before;
+            bool restore = calls.take(&release, before);
+            table->remote_release(&release, restore ? before.data() : nullptr);
+        }
+    }
 
     auto res = req->convert<msg::TuplePutRes>();
     pkt->resize(res->size());
-    comm->send(res->sender, pkt, tid);
+    send_reply(*comm, pkt, tid);
 }
 
 void MessageHandler::handle(Pkt_t* pkt, msg::TuplePutRes* res) {
     // std::cerr << "msg::TuplePutRes tid=" << res->tid << " rid=" << res->rid << " mode=" << static_cast<int>(res->mode) << '\n';
 
-    if (res->mode == AccessMode::INVALID) [[unlikely]] {
+    if (res->mode == AccessMode::INVALID && !replies.enabled) [[unlikely]] { // else a cancel
         std::cerr << "Received TuplePutRes with invalid AccessMode.\n";
     }
 
-    putresponses.handle(res->sender);
+    putresponses.handle(res);
     pkt->free();
 }
 
+void MessageHandler::handle(Pkt_t* pkt, msg::TupleReleaseReq* req) {
+    if (!first_copy(pkt, ReplyCache::Kind::PUT)) {
+        return;
+    }
+
+    auto span = WorkerContext::get().trace.scope(stats::Trace::handle_put_req, req->tid);
+    std::vector<uint8_t> before;
+    bool restore = calls.take(req, before) && !req->commit;
+    db[req->tid]->remote_release(req, restore ? before.data() : nullptr);
+
+    auto res = req->convert<msg::TuplePutRes>();
+    pkt->resize(res->size());
+    send_reply(*comm, pkt, tid);
+}
+
 void MessageHandler::handle(Pkt_t* pkt, msg::SwitchTxn* txn) {
     // std::cerr << "msg::SwitchTxn msg_id=" << txn->msg_id << '\n';
     if constexpr (error::DUMP_SWITCH_PKTS) {
@@ -113,12 +284,42 @@ void MessageHandler::handle(Pkt_t* pkt, msg::SwitchTxn* txn) {
         pkt->dump(std::cerr);
     }
 
+    AbstractFuture* future = nullptr;
     try {
-        auto future = open_futures.erase(txn->msg_id);
-        future->set_pkt(pkt);
+        future = open_futures.erase(txn->msg_id);
     } catch (...) {
-        std::cerr << "Received msg_id=" << txn->msg_id << " without future.\n";
+    }
+    if (!future) { // duplicated on the way, the first copy was delivered
+        WorkerContext::get().cntr.incr(stats::Counter::msg_duplicates);
+        return pkt->free();
+    }
+    future->set_pkt(pkt);
+}
+
+
+bool record_reply(Communicator& comm, Communicator::Pkt_t* pkt) {
+    auto& replies = comm.handler->replies;
+    if (!replies.enabled) [[likely]] {
+        return true;
+    }
+    auto reply = pkt->as<msg::Header>();
+    return replies.record(reply, comm.handler->reply_size(reply));
+}
+
+bool send_reply(Communicator& comm, Communicator::Pkt_t*& pkt, uint32_t tid) {
+    if (!record_reply(comm, pkt)) {
         pkt->free();
-        throw;
+        return false;
     }
+    comm.send(pkt->as<msg::Header>()->sender, pkt, tid);
+    return true;
+}
+
+void keep_undo(Communicator& comm, msg::Header* call, const void* tuple, std::size_t size) {
+    comm.handler->calls.keep(call, tuple, size);
+}
+
+void drop_undo(Communicator& comm, msg::Header* call) {
+    std::vector<uint8_t> before;
+    comm.handler->calls.take(call, before);
 }
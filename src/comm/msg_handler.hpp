@@ -7,9 +7,12 @@
 #include "db/config.hpp"
 #include "db/defs.hpp"
 #include "db/errors.hpp"
+#include "db/fragment.hpp"
 #include "db/future.hpp"
 #include "handlers/barrier.hpp"
 #include "handlers/init.hpp"
+#include "handlers/reply_cache.hpp"
+#include "handlers/tuple_call.hpp"
 #include "handlers/tuple_put_res.hpp"
 
 #include <algorithm>
@@ -17,6 +20,7 @@
 #include <chrono>
 #include <iostream>
 #include <pthread.h>
+#include <random>
 #include <thread>
 #include <vector>
 
@@ -35,6 +39,12 @@ struct MessageHandler {
     InitHandler init;
     BarrierHandler barrier;
     TuplePutResHandler putresponses;
+    ReplyCache replies;
+    TupleCallHandler calls;
+
+    // fault injection, only used by the receiver thread
+    std::minstd_rand drop_rng;
+    std::bernoulli_distribution drop;
 
 
     std::atomic<msg::id_t::type> next_id{0};
@@ -54,7 +64,16 @@ struct MessageHandler {
 
     void handle(Pkt_t* pkt);
 
+    std::size_t reply_size(msg::Header* reply);
+
+    // requester gave up on a remote lock, releases it if it was granted
+    void cancel(msg::node_t target, msg::id_t msg_id, const msg::TupleMsgHeader& req, uint32_t worker_tid);
+
 private:
+    bool inject_drop(msg::Type type);
+    bool first_copy(Pkt_t* pkt, ReplyCache::Kind kind);
+    void deliver(Pkt_t* pkt, msg::id_t msg_id);
+
     void handle(Pkt_t* pkt, msg::Init* msg);
     void handle(Pkt_t* pkt, msg::Barrier* msg);
 
@@ -63,5 +82,9 @@ private:
     void handle(Pkt_t* pkt, msg::TuplePutReq* req);
     void handle(Pkt_t* pkt, msg::TuplePutRes* res);
 
+    void handle(Pkt_t* pkt, msg::TupleCallReq* req);
+    void handle(Pkt_t* pkt, msg::TupleCallRes* res);
+    void handle(Pkt_t* pkt, msg::TupleReleaseReq* req);
+
     void handle(Pkt_t* pkt, msg::SwitchTxn* txn);
 };
\ No newline at end of file
@@ -0,0 +1,222 @@
+#include "shm.hpp"
+
+#include "comm/msg_handler.hpp"
+#include "db/config.hpp"
+#include "stats/collector.hpp"
+#include "stats/stats.hpp"
+
+#include <csignal>
+#include <fcntl.h>
+#include <filesystem>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+
+static constexpr std::size_t RINGS_OFFSET = 64; // after RegionHeader, keeps rings cacheline aligned
+
+
+ShmCommunicator::ShmCommunicator() : pool(NUM_PKTS) {
+    auto& config = Config::instance();
+    node_id = config.node_id;
+    num_nodes = config.num_nodes;
+    switch_id = config.switch_id;
+    shm_name = config.shm_name;
+
+    num_tx_queues = config.num_txn_workers + 1 /* handler */ + 1 /* spin-lock */;
+    mh_tid = config.num_txn_workers;
+    spin_tx_queue = config.num_txn_workers + 1;
+
+    Pkt_t::pool = &pool;
+
+    // every node maps the same region, whoever comes first creates it
+    region_size = RINGS_OFFSET + sizeof(ShmRing) * num_nodes * num_nodes * num_tx_queues;
+    int fd = shm_open(shm_name.c_str(), O_CREAT | O_RDWR, 0600);
+    if (fd < 0) {
+        throw std::runtime_error("shm_open(" + shm_name + ") failed: " + std::strerror(errno));
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (st.st_size != 0 && static_cast<std::size_t>(st.st_size) != region_size) ||
+        (st.st_size == 0 && ftruncate(fd, region_size) != 0)) {
+        close(fd);
+        throw std::runtime_error("shm region " + shm_name + " has wrong size, stale from another run?");
+    }
+    region = mmap(nullptr, region_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (region == MAP_FAILED) {
+        throw std::runtime_error(std::string{"mmap of shm region failed: "} + std::strerror(errno));
+    }
+    rings = reinterpret_cast<ShmRing*>(static_cast<uint8_t*>(region) + RINGS_OFFSET);
+
+    auto header = static_cast<RegionHeader*>(region);
+    uint32_t expected = 0;
+    header->num_nodes.compare_exchange_strong(expected, num_nodes);
+    expected = 0;
+    header->num_queues.compare_exchange_strong(expected, num_tx_queues);
+    if (header->num_nodes != num_nodes || header->num_queues != num_tx_queues) {
+        throw std::runtime_error("shm region " + shm_name + " set up for a different num_nodes/num_txn_workers");
+    }
+
+    if constexpr (ENABLED_STATS & StatsBitmask::PERIODIC) {
+        stats::StatsCollector::get().reg(this, [this](auto& samples) {
+            sample_stats(samples);
+        });
+    }
+}
+
+
+ShmCommunicator::~ShmCommunicator() {
+    if constexpr (ENABLED_STATS & StatsBitmask::PERIODIC) {
+        stats::StatsCollector::get().dereg(static_cast<const void*>(this));
+    }
+    if (thread.joinable()) {
+        thread.request_stop();
+        thread.join();
+    }
+    munmap(region, region_size);
+}
+
+
+void ShmCommunicator::set_handler(MessageHandler* handler) {
+    this->handler = handler;
+    thread = std::jthread([this](std::stop_token token) {
+        receive_loop(token);
+    });
+}
+
+
+void ShmCommunicator::send(msg::node_t target, Pkt_t*& pkt) {
+    const std::lock_guard<lock_t> lock(mutex);
+    push(target, pkt, spin_tx_queue);
+}
+
+void ShmCommunicator::send(msg::node_t target, Pkt_t*& pkt, uint32_t tid) {
+    push(target, pkt, static_cast<uint16_t>(tid));
+}
+
+
+ShmCommunicator::Pkt_t* ShmCommunicator::make_pkt() {
+    return Pkt_t::alloc();
+}
+
+
+void ShmCommunicator::push(msg::node_t target, Pkt_t*& pkt, uint16_t queue) {
+    if (target >= num_nodes) {
+        throw std::runtime_error("shm transport has no switch, target " + std::to_string(target) + " out of bounds");
+    }
+
+    if constexpr (error::DUMP_SWITCH_PKTS) {
+        std::cout << "Packet to: " << target << '\n';
+        pkt->dump(std::cout);
+    }
+
+    auto& r = ring(target, node_id, queue);
+    while (!r.try_push(pkt->buffer, pkt->len)) {
+        __builtin_ia32_pause();
+    }
+    pkt->free();
+    pkt = nullptr;
+}
+
+
+void ShmCommunicator::receive_loop(std::stop_token token) {
+    const WorkerContext::guard worker_ctx;
+    pin_worker(mh_tid);
+
+    constexpr std::size_t MAX_RECEIVE_BURST = 64; // per ring, keeps polling fair
+
+    Pkt_t* pkt = nullptr;
+    while (!token.stop_requested()) {
+        WorkerContext::get().refresh_stats();
+        for (uint32_t src = 0; src < num_nodes; ++src) {
+            for (uint32_t queue = 0; queue < num_tx_queues; ++queue) {
+                auto& r = ring(node_id, src, queue);
+                for (std::size_t i = 0; i < MAX_RECEIVE_BURST; ++i) {
+                    if (!pkt) {
+                        pkt = make_pkt();
+                    }
+                    if (!r.try_pop(pkt)) {
+                        break;
+                    }
+                    handler->handle(pkt);
+                    pkt = nullptr;
+                }
+            }
+        }
+    }
+    if (pkt) {
+        pkt->free();
+    }
+}
+
+
+void ShmCommunicator::sample_stats(std::vector<std::pair<std::string, uint64_t>>& samples) {
+    constexpr uint64_t per_sec = 1s / STATS_PERIODIC_SAMPLE_TIME;
+
+    uint64_t tx_pkts = 0;
+    uint64_t rx_pkts = 0;
+    for (uint32_t node = 0; node < num_nodes; ++node) {
+        for (uint32_t queue = 0; queue < num_tx_queues; ++queue) {
+            tx_pkts += ring(node, node_id, queue).tail.load(std::memory_order_relaxed);
+            rx_pkts += ring(node_id, node, queue).head.load(std::memory_order_relaxed);
+        }
+    }
+    samples.emplace_back("shm_tx_pkts", (tx_pkts - last_tx_pkts) * per_sec);
+    samples.emplace_back("shm_rx_pkts", (rx_pkts - last_rx_pkts) * per_sec);
+    last_tx_pkts = tx_pkts;
+    last_rx_pkts = rx_pkts;
+}
+
+
+int ShmCommunicator::fork_nodes(const std::function<int()>& fn) {
+    auto& config = Config::instance();
+    shm_unlink(config.shm_name.c_str()); // leftovers of a crashed run
+
+    std::vector<pid_t> pids;
+    for (uint32_t i = 0; i < config.num_nodes; ++i) {
+        pid_t pid = fork();
+        if (pid < 0) {
+            std::perror("fork");
+            for (auto p : pids) {
+                kill(p, SIGTERM);
+            }
+            return EXIT_FAILURE;
+        }
+        if (pid == 0) {
+            config.set_node_id(i);
+            auto dir = "node_" + std::to_string(i); // csv files are written to the cwd
+            std::filesystem::create_directories(dir);
+            std::filesystem::current_path(dir);
+            std::exit(fn());
+        }
+        pids.emplace_back(pid);
+    }
+
+    int rc = EXIT_SUCCESS;
+    for (std::size_t remaining = pids.size(); remaining > 0; --remaining) {
+        int status;
+        pid_t pid = wait(&status);
+        if (pid < 0) {
+            std::perror("wait");
+            rc = EXIT_FAILURE;
+            break;
+        }
+        bool failed = !WIFEXITED(status) || WEXITSTATUS(status) != EXIT_SUCCESS;
+        if (failed && rc == EXIT_SUCCESS) {
+            if (WIFSIGNALED(status)) {
+                std::cerr << "node process " << pid << " killed by signal " << WTERMSIG(status) << ", stopping the others\n";
+            } else {
+                std::cerr << "node process " << pid << " exited with " << WEXITSTATUS(status) << ", stopping the others\n";
+            }
+            rc = WIFEXITED(status) ? WEXITSTATUS(status) : EXIT_FAILURE;
+            for (auto p : pids) {
+                if (p != pid) {
+                    kill(p, SIGTERM);
+                }
+            }
+        }
+    }
+    shm_unlink(config.shm_name.c_str());
+    return rc;
+}
@@ -0,0 +1,192 @@
+#pragma once
+
+
+#include "comm/msg.hpp"
+#include "db/errors.hpp"
+#include "db/hex_dump.hpp"
+#include "db/mempools.hpp"
+#include "db/spinlock.hpp"
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+
+struct MessageHandler;
+
+
+struct ShmPacketBuffer {
+    static constexpr std::size_t BUF_SIZE = 1500; // same limit as on the wire
+
+    alignas(16) uint8_t buffer[BUF_SIZE];
+    uint32_t len = 0;
+
+    static inline FixedThreadsafeMempool<ShmPacketBuffer>* pool = nullptr; // owned by ShmCommunicator
+
+    static auto alloc() {
+        auto pkt = pool->allocate();
+        pkt->len = 0;
+        return pkt;
+    }
+
+    template <typename T, typename... Args>
+    auto ctor(Args&&... args) {
+        len = sizeof(T);
+        return new (buffer) T{std::forward<Args>(args)...};
+    }
+
+    template <typename T>
+    auto as() {
+        return reinterpret_cast<T*>(buffer);
+    }
+
+    void resize(const std::size_t len) {
+        if (len > BUF_SIZE) {
+            throw error::PacketBufferTooSmall();
+        }
+        this->len = len;
+    }
+
+    auto size() {
+        return len;
+    }
+
+    uint8_t* data() {
+        return buffer;
+    }
+
+    void free() {
+        pool->deallocate(this);
+    }
+
+    void dump(std::ostream& os) {
+        hex_dump(os, buffer, size());
+    }
+};
+
+
+// Single-producer/single-consumer ring living in shared memory, the memory is
+// zero-initialized by ftruncate() which is a valid empty ring. Packets are
+// copied in and out, so no pointers cross process boundaries.
+struct ShmRing {
+    static constexpr std::size_t SLOTS = 256; // power of 2
+    static_assert((SLOTS & (SLOTS - 1)) == 0);
+    static_assert(std::atomic<uint64_t>::is_always_lock_free); // shared between processes
+
+    struct Slot {
+        uint32_t len;
+        uint8_t data[ShmPacketBuffer::BUF_SIZE];
+    };
+
+    alignas(64) std::atomic<uint64_t> head; // next slot to read, written by consumer
+    alignas(64) std::atomic<uint64_t> tail; // next slot to write, written by producer
+    alignas(64) Slot slots[SLOTS];
+
+    bool try_push(const uint8_t* data, uint32_t len) {
+        auto t = tail.load(std::memory_order_relaxed);
+        if (t - head.load(std::memory_order_acquire) == SLOTS) {
+            return false;
+        }
+        auto& slot = slots[t & (SLOTS - 1)];
+        slot.len = len;
+        std::memcpy(slot.data, data, len);
+        tail.store(t + 1, std::memory_order_release);
+        return true;
+    }
+
+    // copies the oldest packet into pkt
+    bool try_pop(ShmPacketBuffer* pkt) {
+        auto h = head.load(std::memory_order_relaxed);
+        if (h == tail.load(std::memory_order_acquire)) {
+            return false;
+        }
+        auto& slot = slots[h & (SLOTS - 1)];
+        pkt->len = slot.len;
+        std::memcpy(pkt->buffer, slot.data, slot.len);
+        head.store(h + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool empty() {
+        return head.load(std::memory_order_relaxed) == tail.load(std::memory_order_acquire);
+    }
+};
+
+
+// Communicator between processes on one host (see --local_cluster). Every
+// (destination, source, tx-queue) triple owns an SPSC ring in a shm_open()
+// region, so workers never share a producer side, like the per-worker NIC
+// tx-queues of DPDKCommunicator. A full ring blocks the sender until the
+// destination's receiver thread drained it.
+class ShmCommunicator {
+    using lock_t = SpinLock;
+
+    lock_t mutex;
+
+    struct RegionHeader {
+        std::atomic<uint32_t> num_nodes;
+        std::atomic<uint32_t> num_queues;
+    };
+
+    std::string shm_name;
+    void* region = nullptr;
+    std::size_t region_size = 0;
+    ShmRing* rings = nullptr;
+
+    FixedThreadsafeMempool<ShmPacketBuffer> pool;
+    std::jthread thread;
+
+public:
+    using Pkt_t = ShmPacketBuffer;
+
+    static constexpr std::size_t NUM_PKTS = 16384; // per node
+
+    msg::node_t node_id;
+    msg::node_t switch_id;
+    uint32_t num_nodes;
+    uint16_t num_tx_queues;
+    uint32_t mh_tid;
+    uint16_t spin_tx_queue;
+    MessageHandler* handler = nullptr;
+
+    // previous ring positions, to report packet rates in the periodic csv
+    uint64_t last_tx_pkts = 0;
+    uint64_t last_rx_pkts = 0;
+
+public:
+    ShmCommunicator();
+
+    ~ShmCommunicator();
+
+    void set_handler(MessageHandler* handler);
+
+    void send(msg::node_t target, Pkt_t*& pkt);
+    void send(msg::node_t target, Pkt_t*& pkt, uint32_t tid);
+
+    Pkt_t* make_pkt();
+
+    // pushes are plain stores into the rings, nothing to coalesce
+    void begin_batch(uint32_t) {}
+    void end_batch(uint32_t) {}
+
+    // Forks one process per node which runs fn with Config::node_id set and
+    // the working directory changed to node_<id>/, returns the first failing
+    // exit code.
+    static int fork_nodes(const std::function<int()>& fn);
+
+private:
+    ShmRing& ring(uint32_t dst, uint32_t src, uint32_t queue) {
+        return rings[(dst * num_nodes + src) * num_tx_queues + queue];
+    }
+
+    void push(msg::node_t target, Pkt_t*& pkt, uint16_t queue);
+    void receive_loop(std::stop_token token);
+    void sample_stats(std::vector<std::pair<std::string, uint64_t>>& samples);
+};
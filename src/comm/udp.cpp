@@ -2,74 +2,80 @@
 
 #include "db/config.hpp"
 #include "msg_handler.hpp"
+#include "stats/collector.hpp"
+#include "stats/stats.hpp"
 
 
-UDPCommunicator::UDPCommunicator() {
+UDPCommunicator::UDPCommunicator() : pool(NUM_PKTS) {
     auto& config = Config::instance();
     node_id = config.node_id;
     num_nodes = config.num_nodes;
     switch_id = config.switch_id;
+
+    num_rx_queues = config.udp_rx_sockets;
+    num_tx_queues = config.num_txn_workers + 1 /* handler */ + 1 /* spin-lock */;
     mh_tid = config.num_txn_workers;
+    spin_tx_queue = config.num_txn_workers + 1;
 
+    Pkt_t::pool = &pool;
 
-    setup(config.servers.at(node_id).port);
+    setup(config.servers.at(node_id).port, config.udp_busy_poll_us);
 
     addresses.reserve(config.servers.size());
     for (auto& server : config.servers) {
         auto& client_addr = addresses.emplace_back();
+        std::memset(&client_addr, 0, sizeof(client_addr));
 
         client_addr.sin_family = AF_INET;
         inet_pton(AF_INET, server.ip.c_str(), &client_addr.sin_addr);
         client_addr.sin_port = htons(server.port);
     }
+
+    if constexpr (ENABLED_STATS & StatsBitmask::PERIODIC) {
+        stats::StatsCollector::get().reg(this, [this](auto& samples) {
+            sample_stats(samples);
+        });
+    }
 }
 
 UDPCommunicator::~UDPCommunicator() {
-    shutdown(sock, SHUT_RDWR);
-    close(sock);
-    if (recv_buffer) {
-        recv_buffer->free();
+    if constexpr (ENABLED_STATS & StatsBitmask::PERIODIC) {
+        stats::StatsCollector::get().dereg(static_cast<const void*>(this));
+    }
+    if (thread.joinable()) {
+        thread.request_stop();
+        thread.join();
+    }
+    for (auto sock : rx_socks) {
+        shutdown(sock, SHUT_RDWR);
+        close(sock);
+    }
+    for (uint16_t i = 0; i < num_tx_queues; ++i) {
+        close(tx_queues[i].sock);
     }
 }
 
 
 void UDPCommunicator::set_handler(MessageHandler* handler) {
     this->handler = handler;
-    auto& config = Config::instance();
-    thread = std::jthread([&, handler](std::stop_token token) {
-        pin_worker(config.num_txn_workers);
-        while (!token.stop_requested()) {
-            auto pkt = receive();
-            if (!pkt) {
-                continue;
-            }
-            handler->handle(pkt);
-        }
+    thread = std::jthread([this](std::stop_token token) {
+        receive_loop(token);
     });
 }
 
-void UDPCommunicator::send(msg::node_t target, Pkt_t*& pkt, uint32_t) {
-    return send(target, pkt);
+void UDPCommunicator::send(msg::node_t target, Pkt_t*& pkt, uint32_t tid) {
+    auto& q = tx_queues[tid];
+    stage(q, target, pkt);
+    if (!q.batching) {
+        flush(q);
+    }
 }
 
 void UDPCommunicator::send(msg::node_t target, Pkt_t*& pkt) {
-    if (target >= addresses.size()) {
-        throw std::runtime_error("target " + std::to_string(target) + " out of bounds");
-    }
-
-    int len;
-    {
-        const std::lock_guard<lock_t> lock(mutex); // Interestingly locking is faster
-        len = sendto(sock, pkt, pkt->size(), 0, (const struct sockaddr*)&addresses[target], sizeof(struct sockaddr_in));
-    }
-
-    if (len != pkt->size()) {
-        std::perror("sendto failed");
-        std::exit(EXIT_FAILURE);
-    }
-
-    pkt->free();
-    pkt = nullptr; // to detect cause segfault on write
+    const std::lock_guard<lock_t> lock(mutex);
+    auto& q = tx_queues[spin_tx_queue];
+    stage(q, target, pkt);
+    flush(q);
 }
 
 
@@ -78,44 +84,161 @@ UDPCommunicator::Pkt_t* UDPCommunicator::make_pkt() {
 }
 
 
+void UDPCommunicator::begin_batch(uint32_t tid) {
+    tx_queues[tid].batching = true;
+}
+
+void UDPCommunicator::end_batch(uint32_t tid) {
+    auto& q = tx_queues[tid];
+    q.batching = false;
+    flush(q);
+}
+
+
 /* Private Methods */
 
-void UDPCommunicator::setup(uint16_t port) {
-    struct sockaddr_in servaddr;
-    memset(&servaddr, 0, sizeof(servaddr));
+void UDPCommunicator::setup(uint16_t port, int busy_poll_us) {
+    auto make_socket = [&]() {
+        int sock = socket(AF_INET, SOCK_DGRAM, 0);
+        if (sock < 0) {
+            throw std::runtime_error(std::string{"socket creation failed: "} + std::strerror(errno));
+        }
+        int bufsize = 4 * 1024 * 1024; // capped by net.core.[rw]mem_max
+        setsockopt(sock, SOL_SOCKET, SO_RCVBUF, &bufsize, sizeof(bufsize));
+        setsockopt(sock, SOL_SOCKET, SO_SNDBUF, &bufsize, sizeof(bufsize));
+        if (busy_poll_us > 0 && setsockopt(sock, SOL_SOCKET, SO_BUSY_POLL, &busy_poll_us, sizeof(busy_poll_us)) != 0) {
+            std::perror("setsockopt(SO_BUSY_POLL)"); // needs CAP_NET_ADMIN above net.core.busy_poll
+        }
+        return sock;
+    };
 
+    struct sockaddr_in servaddr;
+    std::memset(&servaddr, 0, sizeof(servaddr));
     servaddr.sin_family = AF_INET;
     servaddr.sin_addr.s_addr = htonl(INADDR_ANY);
     servaddr.sin_port = htons(port);
 
-    if ((sock = socket(AF_INET, SOCK_DGRAM, 0)) < 0) {
-        perror("socket creation failed");
-        std::exit(EXIT_FAILURE);
+    // the kernel spreads flows over all sockets bound to the port
+    for (uint16_t i = 0; i < num_rx_queues; ++i) {
+        int sock = make_socket();
+        int one = 1;
+        if (setsockopt(sock, SOL_SOCKET, SO_REUSEPORT, &one, sizeof(one)) != 0) {
+            throw std::runtime_error(std::string{"setsockopt(SO_REUSEPORT) failed: "} + std::strerror(errno));
+        }
+        if (bind(sock, (const struct sockaddr*)&servaddr, sizeof(servaddr)) < 0) {
+            throw std::runtime_error("bind to port " + std::to_string(port) + " failed: " + std::strerror(errno));
+        }
+        rx_socks.emplace_back(sock);
     }
 
-    if (bind(sock, (const struct sockaddr*)&servaddr, sizeof(servaddr)) < 0) {
-        perror("bind failed");
-        std::exit(EXIT_FAILURE);
+    // unbound, replies are addressed by msg::Header::sender and not by source address
+    tx_queues = std::make_unique<TxQueue[]>(num_tx_queues);
+    for (uint16_t i = 0; i < num_tx_queues; ++i) {
+        tx_queues[i].sock = make_socket();
     }
 }
 
 
-UDPCommunicator::Pkt_t* UDPCommunicator::receive() {
-    if (!recv_buffer) {
-        recv_buffer = Pkt_t::alloc();
+void UDPCommunicator::stage(TxQueue& q, msg::node_t target, Pkt_t*& pkt) {
+    if (target >= addresses.size()) {
+        throw std::runtime_error("target " + std::to_string(target) + " out of bounds");
+    }
+
+    if constexpr (error::DUMP_SWITCH_PKTS) {
+        std::cout << "Packet to: " << target << '\n';
+        pkt->dump(std::cout);
+    }
+
+    if (q.size == UDP_BURST) {
+        flush(q);
+    }
+    auto i = q.size++;
+    q.pkts[i] = pkt;
+    q.iovs[i] = {pkt->buffer, pkt->len};
+    std::memset(&q.msgs[i], 0, sizeof(q.msgs[i]));
+    q.msgs[i].msg_hdr.msg_name = &addresses[target];
+    q.msgs[i].msg_hdr.msg_namelen = sizeof(struct sockaddr_in);
+    q.msgs[i].msg_hdr.msg_iov = &q.iovs[i];
+    q.msgs[i].msg_hdr.msg_iovlen = 1;
+    pkt = nullptr; // to detect cause segfault on write
+}
+
+
+void UDPCommunicator::flush(TxQueue& q) {
+    uint32_t done = 0;
+    while (done < q.size) {
+        int n = sendmmsg(q.sock, &q.msgs[done], q.size - done, 0);
+        if (n < 0) {
+            if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR || errno == ENOBUFS) {
+                continue; // socket buffer full, retry
+            }
+            throw std::runtime_error(std::string{"sendmmsg failed: "} + std::strerror(errno));
+        }
+        done += n;
+    }
+    for (uint32_t i = 0; i < q.size; ++i) {
+        q.pkts[i]->free();
+    }
+    q.sent.store(q.sent.load(std::memory_order_relaxed) + q.size, std::memory_order_relaxed);
+    q.size = 0;
+}
+
+
+void UDPCommunicator::receive_loop(std::stop_token token) {
+    const WorkerContext::guard worker_ctx;
+    pin_worker(mh_tid);
+
+    std::array<Pkt_t*, UDP_BURST> pkts;
+    std::array<struct mmsghdr, UDP_BURST> msgs;
+    std::array<struct iovec, UDP_BURST> iovs;
+    std::memset(msgs.data(), 0, sizeof(msgs));
+    for (size_t i = 0; i < UDP_BURST; ++i) {
+        pkts[i] = make_pkt();
+        iovs[i] = {pkts[i]->buffer, Pkt_t::BUF_SIZE};
+        msgs[i].msg_hdr.msg_iov = &iovs[i];
+        msgs[i].msg_hdr.msg_iovlen = 1;
     }
-    int len = recv(sock, recv_buffer, Pkt_t::BUF_SIZE, MSG_DONTWAIT);
-    if (len <= 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)) {
-        return nullptr;
+
+    auto& replies = tx_queues[mh_tid];
+    while (!token.stop_requested()) {
+        WorkerContext::get().refresh_stats();
+        for (auto sock : rx_socks) {
+            int n = recvmmsg(sock, msgs.data(), UDP_BURST, MSG_DONTWAIT, nullptr);
+            if (n <= 0) {
+                continue; // EAGAIN, or socket closed
+            }
+
+            replies.batching = true;
+            for (int i = 0; i < n; ++i) {
+                auto pkt = pkts[i];
+                pkt->len = msgs[i].msg_len;
+                handler->handle(pkt);
+
+                pkts[i] = make_pkt();
+                iovs[i].iov_base = pkts[i]->buffer;
+            }
+            replies.batching = false;
+            flush(replies);
+            rx_pkts.store(rx_pkts.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+        }
     }
-    if (len == 0) {
-        return nullptr;
+
+    for (auto pkt : pkts) {
+        pkt->free();
     }
-    if (len == -1) { // socket close
-        return nullptr;
+}
+
+
+void UDPCommunicator::sample_stats(std::vector<std::pair<std::string, uint64_t>>& samples) {
+    constexpr uint64_t per_sec = 1s / STATS_PERIODIC_SAMPLE_TIME;
+
+    uint64_t tx = 0;
+    for (uint16_t i = 0; i < num_tx_queues; ++i) {
+        tx += tx_queues[i].sent.load(std::memory_order_relaxed);
     }
-    recv_buffer->len = len;
-    auto msg = recv_buffer;
-    recv_buffer = nullptr;
-    return msg;
-}
\ No newline at end of file
+    uint64_t rx = rx_pkts.load(std::memory_order_relaxed);
+    samples.emplace_back("udp_tx_pkts", (tx - last_tx_pkts) * per_sec);
+    samples.emplace_back("udp_rx_pkts", (rx - last_rx_pkts) * per_sec);
+    last_tx_pkts = tx;
+    last_rx_pkts = rx;
+}
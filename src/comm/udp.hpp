@@ -4,13 +4,19 @@
 #include "comm/msg.hpp"
 #include "db/defs.hpp"
 #include "db/errors.hpp"
+#include "db/hex_dump.hpp"
+#include "db/mempools.hpp"
+#include "db/spinlock.hpp"
 #include "server.hpp"
 
 #include <algorithm>
 #include <arpa/inet.h>
+#include <array>
+#include <atomic>
 #include <cstdio>
 #include <cstring>
 #include <iostream>
+#include <memory>
 #include <mutex>
 #include <netinet/in.h>
 #include <stdlib.h>
@@ -18,14 +24,15 @@
 #include <sys/types.h>
 #include <thread>
 #include <unistd.h>
+#include <vector>
 
 
 struct MessageHandler;
 
 
 struct UDPPacketBuffer {
-    UDPPacketBuffer() = delete;
-    ~UDPPacketBuffer() = delete;
+    UDPPacketBuffer() = default;
+    ~UDPPacketBuffer() = default;
 
     UDPPacketBuffer(const UDPPacketBuffer& other) = delete;
     UDPPacketBuffer(UDPPacketBuffer&& other) = delete;
@@ -36,23 +43,26 @@ struct UDPPacketBuffer {
 
     static constexpr std::size_t BUF_SIZE = 1500;
 
-    uint8_t buffer[BUF_SIZE]; // size stored at end
-    int len = 0;
+    alignas(16) uint8_t buffer[BUF_SIZE];
+    uint32_t len = 0;
+
+    static inline FixedThreadsafeMempool<UDPPacketBuffer>* pool = nullptr; // owned by UDPCommunicator
 
     static auto alloc() {
-        void* data = std::malloc(BUF_SIZE + sizeof(int)); // MTU for now
-        return static_cast<UDPPacketBuffer*>(data);
+        auto pkt = pool->allocate();
+        pkt->len = 0;
+        return pkt;
     }
 
     template <typename T, typename... Args>
     auto ctor(Args&&... args) {
         len = sizeof(T);
-        return new (this) T{std::forward<Args>(args)...};
+        return new (buffer) T{std::forward<Args>(args)...};
     }
 
     template <typename T>
     auto as() {
-        return reinterpret_cast<T*>(this);
+        return reinterpret_cast<T*>(buffer);
     }
 
     void resize(const std::size_t len) {
@@ -66,33 +76,48 @@ struct UDPPacketBuffer {
         return len;
     }
 
-    operator uint8_t*() {
-        return reinterpret_cast<uint8_t*>(this);
-    }
-
     void free() {
-        std::free(this);
+        pool->deallocate(this);
     }
 
     void dump(std::ostream& os) {
-        auto bytes = as<uint8_t>();
-        hex_dump(os, bytes, size());
+        hex_dump(os, buffer, size());
     }
 };
 
 
+constexpr size_t UDP_BURST = 64;
+
+
+// Kernel UDP transport for hosts without DPDK NICs. Every tx-queue (worker,
+// handler, spin-lock) has its own socket and sends via sendmmsg, the handler
+// stages its replies during an rx burst and flushes them with one syscall.
+// The receiver thread busy-polls udp_rx_sockets SO_REUSEPORT sockets bound to
+// the node port with recvmmsg into pooled buffers.
 class UDPCommunicator {
-    // using lock_t = std::mutex;
     using lock_t = SpinLock;
 
-    lock_t mutex;
+    lock_t mutex; // spin_tx_queue
+
+    struct alignas(64) TxQueue {
+        int sock = -1;
+        uint32_t size = 0;
+        bool batching = false; // flush explicitly, see begin_batch and the handler's rx bursts
+        std::atomic<uint64_t> sent{0}; // only written by the queue owner
+        std::array<UDPPacketBuffer*, UDP_BURST> pkts;
+        std::array<struct mmsghdr, UDP_BURST> msgs;
+        std::array<struct iovec, UDP_BURST> iovs;
+    };
 
-    int sock;
-    UDPPacketBuffer* recv_buffer = nullptr;
+    std::vector<int> rx_socks;
+    std::unique_ptr<TxQueue[]> tx_queues;
+    FixedThreadsafeMempool<UDPPacketBuffer> pool;
 
 public:
     using Pkt_t = UDPPacketBuffer;
 
+    static constexpr std::size_t NUM_PKTS = 16384;
+
     std::vector<struct sockaddr_in> addresses;
     msg::node_t node_id;
     msg::node_t switch_id;
@@ -100,11 +125,16 @@ public:
     MessageHandler* handler = nullptr;
     std::jthread thread;
 
-
-    // uint16_t num_rx_queues;
-    // uint16_t num_tx_queues;
+    uint16_t num_rx_queues;
+    uint16_t num_tx_queues;
     uint32_t mh_tid;
-    // uint16_t spin_tx_queue;
+    uint16_t spin_tx_queue;
+
+    std::atomic<uint64_t> rx_pkts{0}; // only written by the receiver thread
+
+    // previous counters, to report packet rates in the periodic csv
+    uint64_t last_tx_pkts = 0;
+    uint64_t last_rx_pkts = 0;
 
 
 public:
@@ -116,12 +146,18 @@ public:
     void set_handler(MessageHandler* handler);
 
     void send(msg::node_t target, UDPPacketBuffer*& pkt);
-    void send(msg::node_t target, Pkt_t*& pkt, uint32_t);
+    void send(msg::node_t target, Pkt_t*& pkt, uint32_t tid);
 
 
     UDPPacketBuffer* make_pkt();
 
+    void begin_batch(uint32_t tid);
+    void end_batch(uint32_t tid);
+
 private:
-    UDPPacketBuffer* receive();
-    void setup(uint16_t port);
-};
\ No newline at end of file
+    void setup(uint16_t port, int busy_poll_us);
+    void stage(TxQueue& q, msg::node_t target, Pkt_t*& pkt);
+    void flush(TxQueue& q);
+    void receive_loop(std::stop_token token);
+    void sample_stats(std::vector<std::pair<std::string, uint64_t>>& samples);
+};
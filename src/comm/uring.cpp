@@ -0,0 +1,317 @@
+#include "uring.hpp"
+
+#include "db/config.hpp"
+#include "msg_handler.hpp"
+#include "stats/collector.hpp"
+#include "stats/stats.hpp"
+
+
+IoUringCommunicator::IoUringCommunicator() : pool(NUM_PKTS) {
+    auto& config = Config::instance();
+    node_id = config.node_id;
+    num_nodes = config.num_nodes;
+    switch_id = config.switch_id;
+
+    num_tx_queues = config.num_txn_workers + 1 /* handler */ + 1 /* spin-lock */;
+    mh_tid = config.num_txn_workers;
+    spin_tx_queue = config.num_txn_workers + 1;
+
+    Pkt_t::pool = &pool;
+
+    addresses.reserve(config.servers.size());
+    for (auto& server : config.servers) {
+        auto& client_addr = addresses.emplace_back();
+        std::memset(&client_addr, 0, sizeof(client_addr));
+
+        client_addr.sin_family = AF_INET;
+        inet_pton(AF_INET, server.ip.c_str(), &client_addr.sin_addr);
+        client_addr.sin_port = htons(server.port);
+    }
+
+    tx_rings = std::make_unique<TxRing[]>(num_tx_queues);
+    for (uint16_t i = 0; i < num_tx_queues; ++i) {
+        auto& q = tx_rings[i];
+        // the handler ring also carries the recv and its completions
+        int ret = io_uring_queue_init(2 * QUEUE_DEPTH, &q.ring, 0);
+        if (ret < 0) {
+            throw std::runtime_error(std::string{"io_uring_queue_init failed: "} + std::strerror(-ret));
+        }
+        q.sock = socket(AF_INET, SOCK_DGRAM, 0);
+        if (q.sock < 0) {
+            throw std::runtime_error(std::string{"socket creation failed: "} + std::strerror(errno));
+        }
+        for (uint32_t s = 0; s < QUEUE_DEPTH; ++s) {
+            q.free_slots[s] = s;
+        }
+    }
+    tx_rings[mh_tid].batching = true;
+
+    setup_rx(config.servers.at(node_id).port);
+
+    if constexpr (ENABLED_STATS & StatsBitmask::PERIODIC) {
+        stats::StatsCollector::get().reg(this, [this](auto& samples) {
+            sample_stats(samples);
+        });
+    }
+}
+
+
+IoUringCommunicator::~IoUringCommunicator() {
+    if constexpr (ENABLED_STATS & StatsBitmask::PERIODIC) {
+        stats::StatsCollector::get().dereg(static_cast<const void*>(this));
+    }
+    if (thread.joinable()) {
+        thread.request_stop();
+        thread.join();
+    }
+    close(rx_sock);
+    io_uring_free_buf_ring(&tx_rings[mh_tid].ring, buf_ring, RX_BUFS, RX_BGID);
+    for (uint16_t i = 0; i < num_tx_queues; ++i) {
+        io_uring_queue_exit(&tx_rings[i].ring);
+        close(tx_rings[i].sock);
+    }
+}
+
+
+void IoUringCommunicator::set_handler(MessageHandler* handler) {
+    this->handler = handler;
+    thread = std::jthread([this](std::stop_token token) {
+        receive_loop(token);
+    });
+}
+
+
+void IoUringCommunicator::send(msg::node_t target, Pkt_t*& pkt, uint32_t tid) {
+    auto& q = tx_rings[tid];
+    stage(q, target, pkt);
+    if (!q.batching) {
+        submit(q);
+    }
+}
+
+void IoUringCommunicator::send(msg::node_t target, Pkt_t*& pkt) {
+    const std::lock_guard<lock_t> lock(mutex);
+    auto& q = tx_rings[spin_tx_queue];
+    stage(q, target, pkt);
+    submit(q);
+}
+
+
+IoUringCommunicator::Pkt_t* IoUringCommunicator::make_pkt() {
+    return Pkt_t::alloc();
+}
+
+
+// The handler ring always batches, its submissions go out with the next wait.
+void IoUringCommunicator::begin_batch(uint32_t tid) {
+    if (tid != mh_tid) {
+        tx_rings[tid].batching = true;
+    }
+}
+
+void IoUringCommunicator::end_batch(uint32_t tid) {
+    if (tid != mh_tid) {
+        auto& q = tx_rings[tid];
+        q.batching = false;
+        submit(q);
+    }
+}
+
+
+/* Private Methods */
+
+void IoUringCommunicator::setup_rx(uint16_t port) {
+    rx_sock = socket(AF_INET, SOCK_DGRAM, 0);
+    if (rx_sock < 0) {
+        throw std::runtime_error(std::string{"socket creation failed: "} + std::strerror(errno));
+    }
+    int bufsize = 4 * 1024 * 1024; // capped by net.core.rmem_max
+    setsockopt(rx_sock, SOL_SOCKET, SO_RCVBUF, &bufsize, sizeof(bufsize));
+
+    struct sockaddr_in servaddr;
+    std::memset(&servaddr, 0, sizeof(servaddr));
+    servaddr.sin_family = AF_INET;
+    servaddr.sin_addr.s_addr = htonl(INADDR_ANY);
+    servaddr.sin_port = htons(port);
+    if (bind(rx_sock, (const struct sockaddr*)&servaddr, sizeof(servaddr)) < 0) {
+        throw std::runtime_error("bind to port " + std::to_string(port) + " failed: " + std::strerror(errno));
+    }
+
+    int ret;
+    buf_ring = io_uring_setup_buf_ring(&tx_rings[mh_tid].ring, RX_BUFS, RX_BGID, 0, &ret);
+    if (!buf_ring) {
+        throw std::runtime_error(std::string{"io_uring_setup_buf_ring failed (kernel >= 5.19 needed): "} + std::strerror(-ret));
+    }
+    for (unsigned bid = 0; bid < RX_BUFS; ++bid) {
+        rx_bufs[bid] = make_pkt();
+        io_uring_buf_ring_add(buf_ring, rx_bufs[bid]->buffer, Pkt_t::BUF_SIZE, bid, io_uring_buf_ring_mask(RX_BUFS), bid);
+    }
+    io_uring_buf_ring_advance(buf_ring, RX_BUFS);
+}
+
+
+void IoUringCommunicator::arm_recv(TxRing& q) {
+    auto sqe = io_uring_get_sqe(&q.ring);
+    if (!sqe) {
+        submit(q);
+        sqe = io_uring_get_sqe(&q.ring);
+    }
+    io_uring_prep_recv_multishot(sqe, rx_sock, nullptr, 0, 0);
+    sqe->flags |= IOSQE_BUFFER_SELECT;
+    sqe->buf_group = RX_BGID;
+    io_uring_sqe_set_data64(sqe, RECV_TAG);
+    ++q.unsubmitted;
+}
+
+
+void IoUringCommunicator::stage(TxRing& q, msg::node_t target, Pkt_t*& pkt) {
+    if (target >= addresses.size()) {
+        throw std::runtime_error("target " + std::to_string(target) + " out of bounds");
+    }
+
+    if constexpr (error::DUMP_SWITCH_PKTS) {
+        std::cout << "Packet to: " << target << '\n';
+        pkt->dump(std::cout);
+    }
+
+    while (q.num_free == 0) { // all slots in flight
+        submit(q);
+        reap(q, true);
+    }
+    auto idx = q.free_slots[--q.num_free];
+    auto& slot = q.slots[idx];
+    slot.pkt = pkt;
+    slot.iov = {pkt->buffer, pkt->len};
+    std::memset(&slot.msg, 0, sizeof(slot.msg));
+    slot.msg.msg_name = &addresses[target];
+    slot.msg.msg_namelen = sizeof(struct sockaddr_in);
+    slot.msg.msg_iov = &slot.iov;
+    slot.msg.msg_iovlen = 1;
+
+    auto sqe = io_uring_get_sqe(&q.ring); // SQ has room for QUEUE_DEPTH sends plus the recv
+    io_uring_prep_sendmsg(sqe, q.sock, &slot.msg, 0);
+    io_uring_sqe_set_data64(sqe, idx);
+    ++q.unsubmitted;
+    pkt = nullptr; // to detect cause segfault on write
+}
+
+
+void IoUringCommunicator::submit(TxRing& q) {
+    if (q.unsubmitted > 0) {
+        int ret = io_uring_submit(&q.ring);
+        if (ret < 0) {
+            throw std::runtime_error(std::string{"io_uring_submit failed: "} + std::strerror(-ret));
+        }
+        q.unsubmitted = 0;
+    }
+    reap(q, false);
+}
+
+
+// Completes finished sends, recv completions are left to the receive loop.
+void IoUringCommunicator::reap(TxRing& q, bool wait) {
+    struct io_uring_cqe* cqe;
+    if (wait) {
+        int ret = io_uring_wait_cqe(&q.ring, &cqe);
+        if (ret < 0 && ret != -EINTR) {
+            throw std::runtime_error(std::string{"io_uring_wait_cqe failed: "} + std::strerror(-ret));
+        }
+    }
+
+    unsigned head;
+    unsigned count = 0;
+    uint64_t sent = 0;
+    io_uring_for_each_cqe(&q.ring, head, cqe) {
+        ++count;
+        auto tag = io_uring_cqe_get_data64(cqe);
+        if (tag == RECV_TAG) {
+            rx_pending.push_back(RecvCompletion{cqe->res, cqe->flags});
+            continue;
+        }
+        if (cqe->res < 0) {
+            throw std::runtime_error(std::string{"sendmsg failed: "} + std::strerror(-cqe->res));
+        }
+        q.slots[tag].pkt->free();
+        q.free_slots[q.num_free++] = static_cast<uint32_t>(tag);
+        ++sent;
+    }
+    io_uring_cq_advance(&q.ring, count);
+    q.sent.store(q.sent.load(std::memory_order_relaxed) + sent, std::memory_order_relaxed);
+}
+
+
+void IoUringCommunicator::receive_loop(std::stop_token token) {
+    const WorkerContext::guard worker_ctx;
+    pin_worker(mh_tid);
+
+    auto& q = tx_rings[mh_tid];
+    rx_pending.reserve(2 * QUEUE_DEPTH);
+    arm_recv(q);
+
+    std::vector<RecvCompletion> batch;
+    batch.reserve(2 * QUEUE_DEPTH);
+    struct __kernel_timespec timeout = {0, 100'000}; // to notice stop requests
+    while (!token.stop_requested()) {
+        WorkerContext::get().refresh_stats();
+
+        // submits the replies of the previous batch and waits for the next
+        struct io_uring_cqe* cqe;
+        int ret = io_uring_submit_and_wait_timeout(&q.ring, &cqe, 1, &timeout, nullptr);
+        if (ret < 0 && ret != -ETIME && ret != -EINTR) {
+            throw std::runtime_error(std::string{"io_uring_submit_and_wait_timeout failed: "} + std::strerror(-ret));
+        }
+        q.unsubmitted = 0;
+        reap(q, false);
+
+        bool rearm = false;
+        std::swap(batch, rx_pending); // handling may reap again and append
+        for (auto& c : batch) {
+            handle_recv(c, rearm);
+        }
+        batch.clear();
+        if (rearm) {
+            arm_recv(q);
+        }
+    }
+}
+
+
+void IoUringCommunicator::handle_recv(const RecvCompletion& c, bool& rearm) {
+    if (!(c.flags & IORING_CQE_F_MORE)) { // multishot ended, e.g. -ENOBUFS
+        rearm = true;
+    }
+    if (!(c.flags & IORING_CQE_F_BUFFER)) {
+        return;
+    }
+
+    auto bid = c.flags >> IORING_CQE_BUFFER_SHIFT;
+    auto pkt = rx_bufs[bid];
+
+    // hand the slot a fresh buffer before the packet leaves our hands
+    rx_bufs[bid] = make_pkt();
+    io_uring_buf_ring_add(buf_ring, rx_bufs[bid]->buffer, Pkt_t::BUF_SIZE, bid, io_uring_buf_ring_mask(RX_BUFS), 0);
+    io_uring_buf_ring_advance(buf_ring, 1);
+
+    if (c.res <= 0) {
+        pkt->free();
+        return;
+    }
+    pkt->len = c.res;
+    rx_pkts.store(rx_pkts.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    handler->handle(pkt);
+}
+
+
+void IoUringCommunicator::sample_stats(std::vector<std::pair<std::string, uint64_t>>& samples) {
+    constexpr uint64_t per_sec = 1s / STATS_PERIODIC_SAMPLE_TIME;
+
+    uint64_t tx = 0;
+    for (uint16_t i = 0; i < num_tx_queues; ++i) {
+        tx += tx_rings[i].sent.load(std::memory_order_relaxed);
+    }
+    uint64_t rx = rx_pkts.load(std::memory_order_relaxed);
+    samples.emplace_back("uring_tx_pkts", (tx - last_tx_pkts) * per_sec);
+    samples.emplace_back("uring_rx_pkts", (rx - last_rx_pkts) * per_sec);
+    last_tx_pkts = tx;
+    last_rx_pkts = rx;
+}
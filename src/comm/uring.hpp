@@ -0,0 +1,115 @@
+#pragma once
+
+
+#include "udp.hpp" // UDPPacketBuffer, same wire format and addressing as the udp transport
+
+#include <array>
+#include <atomic>
+#include <liburing.h>
+#include <memory>
+#include <thread>
+#include <vector>
+
+
+struct MessageHandler;
+
+
+// io_uring transport over kernel UDP sockets. Every tx-queue (worker, handler,
+// spin-lock) owns a ring, sends are queued as IORING_OP_SENDMSG and their
+// completions reaped on the next send. The handler's ring also carries one
+// multishot recv that picks receive buffers from a provided buffer ring,
+// packets therefore land directly in pooled packet buffers. Replies generated
+// while handling a batch of completions are submitted together with the wait
+// for the next batch.
+class IoUringCommunicator {
+    using lock_t = SpinLock;
+
+    lock_t mutex; // spin_tx_queue
+
+public:
+    using Pkt_t = UDPPacketBuffer;
+
+    static constexpr std::size_t NUM_PKTS = 16384;
+    static constexpr unsigned QUEUE_DEPTH = 256; // in-flight sends per ring
+    static constexpr unsigned RX_BUFS = 1024;    // provided receive buffers, power of 2
+    static_assert((RX_BUFS & (RX_BUFS - 1)) == 0);
+
+private:
+    static constexpr int RX_BGID = 0;
+    static constexpr uint64_t RECV_TAG = ~0ull;
+
+    struct SendSlot {
+        struct msghdr msg;
+        struct iovec iov;
+        Pkt_t* pkt;
+    };
+
+    struct RecvCompletion {
+        int32_t res;
+        uint32_t flags;
+    };
+
+    struct alignas(64) TxRing {
+        struct io_uring ring;
+        int sock = -1;
+        uint32_t num_free = QUEUE_DEPTH;
+        uint32_t unsubmitted = 0;
+        bool batching = false; // submitted by the owner's loop, set for the handler
+        std::atomic<uint64_t> sent{0}; // only written by the ring owner
+        std::array<SendSlot, QUEUE_DEPTH> slots;
+        std::array<uint32_t, QUEUE_DEPTH> free_slots;
+    };
+
+    FixedThreadsafeMempool<Pkt_t> pool;
+    std::unique_ptr<TxRing[]> tx_rings;
+
+    int rx_sock = -1;
+    struct io_uring_buf_ring* buf_ring = nullptr;
+    std::array<Pkt_t*, RX_BUFS> rx_bufs{};
+    std::vector<RecvCompletion> rx_pending; // only used by the receiver thread
+
+public:
+    std::vector<struct sockaddr_in> addresses;
+    msg::node_t node_id;
+    msg::node_t switch_id;
+    uint32_t num_nodes;
+    MessageHandler* handler = nullptr;
+    std::jthread thread;
+
+    uint16_t num_tx_queues;
+    uint32_t mh_tid;
+    uint16_t spin_tx_queue;
+
+    std::atomic<uint64_t> rx_pkts{0}; // only written by the receiver thread
+
+    // previous counters, to report packet rates in the periodic csv
+    uint64_t last_tx_pkts = 0;
+    uint64_t last_rx_pkts = 0;
+
+public:
+    IoUringCommunicator();
+
+    ~IoUringCommunicator();
+
+    void set_handler(MessageHandler* handler);
+
+    void send(msg::node_t target, Pkt_t*& pkt);
+    void send(msg::node_t target, Pkt_t*& pkt, uint32_t tid);
+
+    Pkt_t* make_pkt();
+
+    void begin_batch(uint32_t tid);
+    void end_batch(uint32_t tid);
+
+private:
+    void setup_rx(uint16_t port);
+    void arm_recv(TxRing& q);
+
+    void stage(TxRing& q, msg::node_t target, Pkt_t*& pkt);
+    void submit(TxRing& q);
+    void reap(TxRing& q, bool wait);
+
+    void receive_loop(std::stop_token token);
+    void handle_recv(const RecvCompletion& c, bool& rearm);
+    void sample_stats(std::vector<std::pair<std::string, uint64_t>>& samples);
+};
@@ -0,0 +1,438 @@
+#include "xdp.hpp"
+
+#include "db/config.hpp"
+#include "msg_handler.hpp"
+#include "stats/collector.hpp"
+#include "stats/stats.hpp"
+
+#include <arpa/inet.h>
+#include <linux/bpf.h>
+#include <net/if.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+
+static constexpr uint16_t ETHER_TYPE = 0x1000;
+
+
+static int sys_bpf(enum bpf_cmd cmd, union bpf_attr& attr) {
+    return static_cast<int>(syscall(__NR_bpf, cmd, &attr, sizeof(attr)));
+}
+
+
+XDPCommunicator::XDPCommunicator() : pool(NUM_PKTS) {
+    auto& config = Config::instance();
+    node_id = config.node_id;
+    num_nodes = config.num_nodes;
+    switch_id = config.switch_id;
+
+    num_tx_queues = config.num_txn_workers + 1 /* handler */ + 1 /* spin-lock */;
+    mh_tid = config.num_txn_workers;
+    spin_tx_queue = config.num_txn_workers + 1;
+
+    Pkt_t::pool = &pool;
+    umem = reinterpret_cast<uint8_t*>(pool.data.get());
+
+    ifindex = if_nametoindex(config.xdp_iface.c_str());
+    if (ifindex == 0) {
+        throw std::runtime_error("xdp interface " + config.xdp_iface + ": " + std::strerror(errno));
+    }
+
+    targets.reserve(config.servers.size());
+    for (auto& server : config.servers) {
+        targets.emplace_back(server.mac);
+    }
+    src_mac = targets[node_id].mac;
+
+    struct ifreq ifr;
+    std::memset(&ifr, 0, sizeof(ifr));
+    std::strncpy(ifr.ifr_name, config.xdp_iface.c_str(), IFNAMSIZ - 1);
+    int sock = socket(AF_INET, SOCK_DGRAM, 0);
+    int rc = ioctl(sock, SIOCGIFHWADDR, &ifr);
+    close(sock);
+    if (rc != 0 || !(src_mac == *reinterpret_cast<eth_addr_t*>(ifr.ifr_hwaddr.sa_data))) {
+        throw std::runtime_error("macs do not match");
+    }
+
+    load_program();
+
+    xsks = std::make_unique<Xsk[]>(num_tx_queues);
+    for (uint16_t i = 0; i < num_tx_queues; ++i) {
+        xsks[i].queue_id = config.xdp_queue + i;
+        setup_socket(xsks[i]);
+    }
+
+    if constexpr (ENABLED_STATS & StatsBitmask::PERIODIC) {
+        stats::StatsCollector::get().reg(this, [this](auto& samples) {
+            sample_stats(samples);
+        });
+    }
+}
+
+
+XDPCommunicator::~XDPCommunicator() {
+    if constexpr (ENABLED_STATS & StatsBitmask::PERIODIC) {
+        stats::StatsCollector::get().dereg(static_cast<const void*>(this));
+    }
+    if (thread.joinable()) {
+        thread.request_stop();
+        thread.join();
+    }
+    for (auto pkt : loopback_pkts) {
+        pkt->free();
+    }
+    close(link_fd); // detaches the program
+    close(prog_fd);
+    close(xsks_map_fd);
+    for (uint16_t i = 0; i < num_tx_queues; ++i) {
+        auto& xsk = xsks[i];
+        munmap(xsk.rx.map, xsk.rx.map_size);
+        munmap(xsk.tx.map, xsk.tx.map_size);
+        munmap(xsk.fill.map, xsk.fill.map_size);
+        munmap(xsk.comp.map, xsk.comp.map_size);
+        close(xsk.fd);
+    }
+}
+
+
+void XDPCommunicator::set_handler(MessageHandler* handler) {
+    this->handler = handler;
+    thread = std::jthread([this](std::stop_token token) {
+        receive_loop(token);
+    });
+}
+
+
+void XDPCommunicator::send(msg::node_t target, Pkt_t*& pkt, uint32_t tid) {
+    if (target == node_id) {
+        loopback(pkt);
+        return;
+    }
+    auto& xsk = xsks[tid];
+    stage(xsk, target, pkt);
+    if (!xsk.batching) {
+        flush(xsk);
+    }
+}
+
+void XDPCommunicator::send(msg::node_t target, Pkt_t*& pkt) {
+    if (target == node_id) {
+        loopback(pkt);
+        return;
+    }
+    const std::lock_guard<lock_t> lock(mutex);
+    auto& xsk = xsks[spin_tx_queue];
+    stage(xsk, target, pkt);
+    flush(xsk);
+}
+
+
+XDPCommunicator::Pkt_t* XDPCommunicator::make_pkt() {
+    return Pkt_t::alloc();
+}
+
+
+void XDPCommunicator::begin_batch(uint32_t tid) {
+    xsks[tid].batching = true;
+}
+
+void XDPCommunicator::end_batch(uint32_t tid) {
+    auto& xsk = xsks[tid];
+    xsk.batching = false;
+    flush(xsk);
+}
+
+
+/* Private Methods */
+
+// Redirects frames with our ETHER_TYPE to the socket of their rx queue,
+// everything else (and frames of queues without socket) goes to the kernel.
+void XDPCommunicator::load_program() {
+    auto& config = Config::instance();
+
+    union bpf_attr attr;
+    std::memset(&attr, 0, sizeof(attr));
+    attr.map_type = BPF_MAP_TYPE_XSKMAP;
+    attr.key_size = sizeof(uint32_t);
+    attr.value_size = sizeof(int);
+    attr.max_entries = config.xdp_queue + num_tx_queues;
+    xsks_map_fd = sys_bpf(BPF_MAP_CREATE, attr);
+    if (xsks_map_fd < 0) {
+        throw std::runtime_error(std::string{"xskmap creation failed: "} + std::strerror(errno));
+    }
+
+    auto insn = [](uint8_t code, uint8_t dst, uint8_t src, int16_t off, int32_t imm) {
+        return bpf_insn{code, dst, src, off, imm};
+    };
+    // clang-format off
+    const struct bpf_insn prog[] = {
+        insn(BPF_LDX | BPF_MEM | BPF_W, BPF_REG_2, BPF_REG_1, offsetof(struct xdp_md, data), 0),
+        insn(BPF_LDX | BPF_MEM | BPF_W, BPF_REG_3, BPF_REG_1, offsetof(struct xdp_md, data_end), 0),
+        insn(BPF_ALU64 | BPF_MOV | BPF_X, BPF_REG_4, BPF_REG_2, 0, 0),
+        insn(BPF_ALU64 | BPF_ADD | BPF_K, BPF_REG_4, 0, 0, sizeof(eth_hdr_t)),
+        insn(BPF_JMP | BPF_JGT | BPF_X, BPF_REG_4, BPF_REG_3, 8, 0),               // too short -> pass
+        insn(BPF_LDX | BPF_MEM | BPF_H, BPF_REG_4, BPF_REG_2, offsetof(eth_hdr_t, type), 0),
+        insn(BPF_JMP | BPF_JNE | BPF_K, BPF_REG_4, 0, 6, htons(ETHER_TYPE)),        // not ours -> pass
+        insn(BPF_LDX | BPF_MEM | BPF_W, BPF_REG_2, BPF_REG_1, offsetof(struct xdp_md, rx_queue_index), 0),
+        insn(BPF_LD | BPF_DW | BPF_IMM, BPF_REG_1, BPF_PSEUDO_MAP_FD, 0, xsks_map_fd),
+        insn(0, 0, 0, 0, 0),
+        insn(BPF_ALU64 | BPF_MOV | BPF_K, BPF_REG_3, 0, 0, XDP_PASS),               // no socket -> pass
+        insn(BPF_JMP | BPF_CALL, 0, 0, 0, BPF_FUNC_redirect_map),
+        insn(BPF_JMP | BPF_EXIT, 0, 0, 0, 0),
+        insn(BPF_ALU64 | BPF_MOV | BPF_K, BPF_REG_0, 0, 0, XDP_PASS),
+        insn(BPF_JMP | BPF_EXIT, 0, 0, 0, 0),
+    };
+    // clang-format on
+
+    char log[4096] = {};
+    std::memset(&attr, 0, sizeof(attr));
+    attr.prog_type = BPF_PROG_TYPE_XDP;
+    attr.insns = reinterpret_cast<uint64_t>(prog);
+    attr.insn_cnt = sizeof(prog) / sizeof(prog[0]);
+    attr.license = reinterpret_cast<uint64_t>("GPL");
+    attr.log_buf = reinterpret_cast<uint64_t>(log);
+    attr.log_size = sizeof(log);
+    attr.log_level = 1;
+    prog_fd = sys_bpf(BPF_PROG_LOAD, attr);
+    if (prog_fd < 0) {
+        throw std::runtime_error(std::string{"xdp program load failed: "} + std::strerror(errno) + '\n' + log);
+    }
+
+    // a bpf_link detaches the program when we exit, also on crashes
+    std::memset(&attr, 0, sizeof(attr));
+    attr.link_create.prog_fd = prog_fd;
+    attr.link_create.target_ifindex = ifindex;
+    attr.link_create.attach_type = BPF_XDP;
+    link_fd = sys_bpf(BPF_LINK_CREATE, attr);
+    if (link_fd < 0) {
+        throw std::runtime_error("xdp attach to " + config.xdp_iface + " failed: " + std::strerror(errno));
+    }
+}
+
+
+void XDPCommunicator::setup_socket(Xsk& xsk) {
+    const bool owns_umem = &xsk == &xsks[0];
+
+    xsk.fd = socket(AF_XDP, SOCK_RAW, 0);
+    if (xsk.fd < 0) {
+        throw std::runtime_error(std::string{"AF_XDP socket creation failed: "} + std::strerror(errno));
+    }
+    auto sockopt = [&](int opt, const void* val, socklen_t len, const char* name) {
+        if (setsockopt(xsk.fd, SOL_XDP, opt, val, len) != 0) {
+            throw std::runtime_error(std::string{"setsockopt("} + name + ") failed: " + std::strerror(errno));
+        }
+    };
+
+    if (owns_umem) {
+        struct xdp_umem_reg mr;
+        std::memset(&mr, 0, sizeof(mr));
+        mr.addr = reinterpret_cast<uint64_t>(umem);
+        mr.len = NUM_PKTS * Pkt_t::FRAME_SIZE;
+        mr.chunk_size = Pkt_t::FRAME_SIZE;
+        mr.headroom = Pkt_t::HEADROOM;
+        sockopt(XDP_UMEM_REG, &mr, sizeof(mr), "XDP_UMEM_REG");
+    }
+    // every socket needs its own fill and completion ring, they are bound to different queues
+    const int ring_size = RING_SIZE;
+    sockopt(XDP_UMEM_FILL_RING, &ring_size, sizeof(ring_size), "XDP_UMEM_FILL_RING");
+    sockopt(XDP_UMEM_COMPLETION_RING, &ring_size, sizeof(ring_size), "XDP_UMEM_COMPLETION_RING");
+    sockopt(XDP_RX_RING, &ring_size, sizeof(ring_size), "XDP_RX_RING");
+    sockopt(XDP_TX_RING, &ring_size, sizeof(ring_size), "XDP_TX_RING");
+
+    struct xdp_mmap_offsets off;
+    socklen_t optlen = sizeof(off);
+    if (getsockopt(xsk.fd, SOL_XDP, XDP_MMAP_OFFSETS, &off, &optlen) != 0) {
+        throw std::runtime_error(std::string{"getsockopt(XDP_MMAP_OFFSETS) failed: "} + std::strerror(errno));
+    }
+
+    auto map_ring = [&]<typename T>(Ring<T>& r, const struct xdp_ring_offset& o, off_t pgoff) {
+        r.map_size = o.desc + RING_SIZE * sizeof(T);
+        r.map = mmap(nullptr, r.map_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, xsk.fd, pgoff);
+        if (r.map == MAP_FAILED) {
+            throw std::runtime_error(std::string{"mmap of xsk ring failed: "} + std::strerror(errno));
+        }
+        auto base = static_cast<uint8_t*>(r.map);
+        r.producer = reinterpret_cast<std::atomic<uint32_t>*>(base + o.producer);
+        r.consumer = reinterpret_cast<std::atomic<uint32_t>*>(base + o.consumer);
+        r.flags = reinterpret_cast<uint32_t*>(base + o.flags);
+        r.ring = reinterpret_cast<T*>(base + o.desc);
+        r.cached_prod = r.producer->load(std::memory_order_relaxed);
+        r.cached_cons = r.consumer->load(std::memory_order_relaxed);
+    };
+    map_ring(xsk.rx, off.rx, XDP_PGOFF_RX_RING);
+    map_ring(xsk.tx, off.tx, XDP_PGOFF_TX_RING);
+    map_ring(xsk.fill, off.fr, XDP_UMEM_PGOFF_FILL_RING);
+    map_ring(xsk.comp, off.cr, XDP_UMEM_PGOFF_COMPLETION_RING);
+
+    struct sockaddr_xdp sxdp;
+    std::memset(&sxdp, 0, sizeof(sxdp));
+    sxdp.sxdp_family = AF_XDP;
+    sxdp.sxdp_ifindex = ifindex;
+    sxdp.sxdp_queue_id = xsk.queue_id;
+    if (owns_umem) {
+        sxdp.sxdp_flags = XDP_USE_NEED_WAKEUP;
+    } else {
+        sxdp.sxdp_flags = XDP_SHARED_UMEM; // inherits the mode flags, passing them is EINVAL
+        sxdp.sxdp_shared_umem_fd = xsks[0].fd;
+    }
+    if (bind(xsk.fd, reinterpret_cast<struct sockaddr*>(&sxdp), sizeof(sxdp)) != 0) {
+        throw std::runtime_error("bind to queue " + std::to_string(xsk.queue_id) + " failed: " + std::strerror(errno));
+    }
+
+    refill(xsk, RING_SIZE);
+
+    union bpf_attr attr;
+    std::memset(&attr, 0, sizeof(attr));
+    attr.map_fd = xsks_map_fd;
+    attr.key = reinterpret_cast<uint64_t>(&xsk.queue_id);
+    attr.value = reinterpret_cast<uint64_t>(&xsk.fd);
+    if (sys_bpf(BPF_MAP_UPDATE_ELEM, attr) != 0) {
+        throw std::runtime_error(std::string{"xskmap update failed: "} + std::strerror(errno));
+    }
+}
+
+
+void XDPCommunicator::loopback(Pkt_t*& pkt) {
+    pkt->ctor_eth(src_mac, src_mac, be_uint16_t{ETHER_TYPE});
+    const std::lock_guard<lock_t> lock(loopback_mutex);
+    loopback_pkts.emplace_back(pkt);
+    pkt = nullptr;
+}
+
+
+void XDPCommunicator::stage(Xsk& xsk, msg::node_t target, Pkt_t*& pkt) {
+    if (target >= targets.size()) {
+        throw std::runtime_error("target " + std::to_string(target) + " out of bounds");
+    }
+    pkt->ctor_eth(targets[target].mac, src_mac, be_uint16_t{ETHER_TYPE});
+
+    if constexpr (error::DUMP_SWITCH_PKTS) {
+        std::cout << "Packet to: " << target << '\n';
+        pkt->dump(std::cout);
+    }
+
+    while (xsk.in_flight == RING_SIZE) { // tx and completion ring full
+        flush(xsk);
+    }
+    auto& desc = xsk.tx[xsk.tx.cached_prod++];
+    desc.addr = addr_of(pkt) + pkt->off;
+    desc.len = pkt->len;
+    desc.options = 0;
+    ++xsk.in_flight;
+    pkt = nullptr; // to detect cause segfault on write
+}
+
+
+void XDPCommunicator::flush(Xsk& xsk) {
+    xsk.tx.submit();
+    // in copy mode each sendto transmits only a limited batch, so kick until
+    // the kernel took all, zero-copy drivers clear the flag while busy
+    while (xsk.tx.needs_wakeup() && xsk.tx.consumer->load(std::memory_order_acquire) != xsk.tx.cached_prod) {
+        if (sendto(xsk.fd, nullptr, 0, MSG_DONTWAIT, nullptr, 0) < 0 && errno != EAGAIN && errno != EBUSY &&
+            errno != ENOBUFS && errno != EINTR) {
+            throw std::runtime_error(std::string{"xsk sendto failed: "} + std::strerror(errno));
+        }
+        reap(xsk); // frees completion ring space
+    }
+    reap(xsk);
+}
+
+
+void XDPCommunicator::reap(Xsk& xsk) {
+    uint32_t n = xsk.comp.available();
+    if (n == 0) {
+        return;
+    }
+    for (uint32_t i = 0; i < n; ++i) {
+        frame_at(xsk.comp[xsk.comp.cached_cons++])->free();
+    }
+    xsk.comp.release();
+    xsk.in_flight -= n;
+    xsk.sent.store(xsk.sent.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+}
+
+
+void XDPCommunicator::refill(Xsk& xsk, uint32_t n) {
+    n = std::min(n, xsk.fill.free());
+    for (uint32_t i = 0; i < n; ++i) {
+        xsk.fill[xsk.fill.cached_prod++] = addr_of(make_pkt());
+    }
+    xsk.fill.submit();
+}
+
+
+void XDPCommunicator::receive_loop(std::stop_token token) {
+    const WorkerContext::guard worker_ctx;
+    pin_worker(mh_tid);
+
+    auto& replies = xsks[mh_tid];
+    std::vector<Pkt_t*> local;
+    while (!token.stop_requested()) {
+        WorkerContext::get().refresh_stats();
+        {
+            const std::lock_guard<lock_t> lock(loopback_mutex);
+            std::swap(local, loopback_pkts);
+        }
+        for (auto pkt : local) {
+            handler->handle(pkt);
+        }
+        local.clear();
+
+        for (uint16_t q = 0; q < num_tx_queues; ++q) {
+            auto& xsk = xsks[q];
+            uint32_t n = std::min(xsk.rx.available(), XDP_BURST);
+            if (n == 0) {
+                if (xsk.fill.needs_wakeup()) { // driver ran out of rx frames
+                    recvfrom(xsk.fd, nullptr, 0, MSG_DONTWAIT, nullptr, nullptr);
+                }
+                continue;
+            }
+
+            replies.batching = true;
+            for (uint32_t i = 0; i < n; ++i) {
+                auto& desc = xsk.rx[xsk.rx.cached_cons++];
+                auto pkt = frame_at(desc.addr);
+                pkt->off = desc.addr - addr_of(pkt);
+                pkt->len = desc.len;
+                handler->handle(pkt);
+            }
+            xsk.rx.release();
+            replies.batching = false;
+            flush(replies);
+
+            refill(xsk, n);
+            rx_pkts.store(rx_pkts.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+        }
+    }
+}
+
+
+void XDPCommunicator::sample_stats(std::vector<std::pair<std::string, uint64_t>>& samples) {
+    constexpr uint64_t per_sec = 1s / STATS_PERIODIC_SAMPLE_TIME;
+
+    uint64_t tx = 0;
+    uint64_t rx_dropped = 0;
+    uint64_t fill_empty = 0;
+    for (uint16_t i = 0; i < num_tx_queues; ++i) {
+        tx += xsks[i].sent.load(std::memory_order_relaxed);
+
+        struct xdp_statistics xs;
+        socklen_t optlen = sizeof(xs);
+        if (getsockopt(xsks[i].fd, SOL_XDP, XDP_STATISTICS, &xs, &optlen) == 0) {
+            rx_dropped += xs.rx_dropped + xs.rx_ring_full;
+            fill_empty += xs.rx_fill_ring_empty_descs;
+        }
+    }
+    uint64_t rx = rx_pkts.load(std::memory_order_relaxed);
+    samples.emplace_back("xdp_tx_pkts", (tx - last_tx_pkts) * per_sec);
+    samples.emplace_back("xdp_rx_pkts", (rx - last_rx_pkts) * per_sec);
+    samples.emplace_back("xdp_rx_dropped", (rx_dropped - last_rx_dropped) * per_sec);
+    samples.emplace_back("xdp_fill_empty", (fill_empty - last_fill_empty) * per_sec);
+    last_tx_pkts = tx;
+    last_rx_pkts = rx;
+    last_rx_dropped = rx_dropped;
+    last_fill_empty = fill_empty;
+}
@@ -0,0 +1,238 @@
+#pragma once
+
+
+#include "comm/msg.hpp"
+#include "db/defs.hpp"
+#include "db/errors.hpp"
+#include "db/hex_dump.hpp"
+#include "db/mempools.hpp"
+#include "db/spinlock.hpp"
+#include "eth_hdr.hpp"
+#include "server.hpp"
+
+#include <atomic>
+#include <cstring>
+#include <iostream>
+#include <linux/if_xdp.h>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+
+struct MessageHandler;
+
+
+// One UMEM frame, the pool of frames is registered as UMEM so packets are
+// handed to the kernel without copying. The frame starts with our metadata,
+// packet data begins at off (fixed for tx, set by the kernel for rx).
+struct alignas(4096) XDPPacketBuffer {
+    XDPPacketBuffer() = default;
+    ~XDPPacketBuffer() = default;
+
+    XDPPacketBuffer(const XDPPacketBuffer& other) = delete;
+    XDPPacketBuffer(XDPPacketBuffer&& other) = delete;
+
+    XDPPacketBuffer& operator=(const XDPPacketBuffer& other) = delete;
+    XDPPacketBuffer& operator=(XDPPacketBuffer&& other) = delete;
+
+
+    static constexpr std::size_t FRAME_SIZE = 4096;
+    static constexpr uint32_t HEADROOM = 64;                       // UMEM frame_headroom, holds off and len
+    static constexpr uint32_t TX_OFFSET = HEADROOM + 256 /* XDP_PACKET_HEADROOM */; // like rx
+
+    uint32_t off = TX_OFFSET;
+    uint32_t len = 0;
+    uint8_t frame[FRAME_SIZE - 2 * sizeof(uint32_t)];
+
+    static inline FixedThreadsafeMempool<XDPPacketBuffer>* pool = nullptr; // owned by XDPCommunicator
+
+    struct pkt_t {
+        eth_hdr_t eth;
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wpedantic"
+        msg::Header msg[0];
+#pragma GCC diagnostic pop
+    };
+
+
+    static auto alloc() {
+        auto pkt = pool->allocate();
+        pkt->off = TX_OFFSET;
+        pkt->len = 0;
+        return pkt;
+    }
+
+    uint8_t* data() {
+        return reinterpret_cast<uint8_t*>(this) + off;
+    }
+
+    template <typename T, typename... Args>
+    auto ctor(Args&&... args) {
+        resize(sizeof(T));
+        pkt_t* pkt = reinterpret_cast<pkt_t*>(data());
+        return new (pkt->msg) T{std::forward<Args>(args)...};
+    }
+
+    template <typename T>
+    auto as() {
+        pkt_t* pkt = reinterpret_cast<pkt_t*>(data());
+        return reinterpret_cast<T*>(pkt->msg);
+    }
+
+    void resize(const std::size_t len) {
+        if (off + sizeof(pkt_t) + len > FRAME_SIZE) {
+            throw error::PacketBufferTooSmall();
+        }
+        this->len = sizeof(pkt_t) + len;
+    }
+
+    auto size() {
+        return len;
+    }
+
+    void free() {
+        pool->deallocate(this);
+    }
+
+    void dump(std::ostream& os) {
+        hex_dump(os, data(), size());
+    }
+
+private:
+    template <typename... Args>
+    void ctor_eth(Args&&... args) {
+        pkt_t* pkt = reinterpret_cast<pkt_t*>(data());
+        new (&pkt->eth) eth_hdr_t{std::forward<Args>(args)...};
+    }
+
+    friend class XDPCommunicator;
+};
+static_assert(sizeof(XDPPacketBuffer) == XDPPacketBuffer::FRAME_SIZE);
+
+
+// AF_XDP transport, kernel bypass without DPDK: the NIC stays with the kernel
+// and an XDP program redirects only our ETHER_TYPE to the sockets. All frames
+// of the packet pool form one UMEM shared by one XSK socket per tx-queue
+// (worker, handler, spin-lock), socket i is bound to queue xdp_queue+i. The
+// receiver thread polls the rx rings of all sockets and refills their fill
+// rings, each tx-queue owner reaps its own completion ring.
+class XDPCommunicator {
+    using lock_t = SpinLock;
+
+    lock_t mutex; // spin_tx_queue
+
+public:
+    using Pkt_t = XDPPacketBuffer;
+
+    static constexpr std::size_t NUM_PKTS = 16384;
+    static constexpr uint32_t RING_SIZE = 512; // all four rings per socket, power of 2
+    static constexpr uint32_t XDP_BURST = 64;
+
+private:
+    // single producer/consumer view of a mmap'ed socket ring
+    template <typename T>
+    struct Ring {
+        std::atomic<uint32_t>* producer;
+        std::atomic<uint32_t>* consumer;
+        uint32_t* flags;
+        T* ring;
+        uint32_t cached_prod = 0;
+        uint32_t cached_cons = 0;
+        void* map = nullptr;
+        std::size_t map_size = 0;
+
+        T& operator[](uint32_t i) { return ring[i & (RING_SIZE - 1)]; }
+
+        // producer side, returns number of free entries starting at cached_prod
+        uint32_t free() { return RING_SIZE - (cached_prod - consumer->load(std::memory_order_acquire)); }
+        void submit() { producer->store(cached_prod, std::memory_order_release); }
+
+        // consumer side, returns number of entries starting at cached_cons
+        uint32_t available() { return producer->load(std::memory_order_acquire) - cached_cons; }
+        void release() { consumer->store(cached_cons, std::memory_order_release); }
+
+        bool needs_wakeup() { return *flags & XDP_RING_NEED_WAKEUP; }
+    };
+
+    struct alignas(64) Xsk {
+        int fd = -1;
+        uint32_t queue_id;
+        Ring<struct xdp_desc> rx;
+        Ring<struct xdp_desc> tx;
+        Ring<uint64_t> fill;
+        Ring<uint64_t> comp;
+        uint32_t in_flight = 0; // sent, not yet completed
+        bool batching = false;  // submit explicitly, see begin_batch and the handler's rx bursts
+        std::atomic<uint64_t> sent{0}; // only written by the queue owner
+    };
+
+    FixedThreadsafeMempool<Pkt_t> pool;
+    uint8_t* umem = nullptr;
+    std::unique_ptr<Xsk[]> xsks;
+
+    lock_t loopback_mutex;
+    std::vector<Pkt_t*> loopback_pkts; // sent to ourselves, the NIC does not hairpin them
+
+    int ifindex;
+    int xsks_map_fd = -1;
+    int prog_fd = -1;
+    int link_fd = -1;
+
+public:
+    eth_addr_t src_mac;
+    struct target_info {
+        eth_addr_t mac;
+    };
+    std::vector<target_info> targets;
+
+    msg::node_t node_id;
+    msg::node_t switch_id;
+    uint32_t num_nodes;
+    MessageHandler* handler = nullptr;
+    std::jthread thread;
+
+    uint16_t num_tx_queues;
+    uint32_t mh_tid;
+    uint16_t spin_tx_queue;
+
+    std::atomic<uint64_t> rx_pkts{0}; // only written by the receiver thread
+
+    // previous counters, to report packet rates in the periodic csv
+    uint64_t last_tx_pkts = 0;
+    uint64_t last_rx_pkts = 0;
+    uint64_t last_rx_dropped = 0;
+    uint64_t last_fill_empty = 0;
+
+public:
+    XDPCommunicator();
+
+    ~XDPCommunicator();
+
+    void set_handler(MessageHandler* handler);
+
+    void send(msg::node_t target, Pkt_t*& pkt);
+    void send(msg::node_t target, Pkt_t*& pkt, uint32_t tid);
+
+    Pkt_t* make_pkt();
+
+    void begin_batch(uint32_t tid);
+    void end_batch(uint32_t tid);
+
+private:
+    void setup_socket(Xsk& xsk);
+    void load_program();
+
+    uint64_t addr_of(Pkt_t* pkt) { return reinterpret_cast<uint8_t*>(pkt) - umem; }
+    Pkt_t* frame_at(uint64_t addr) { return reinterpret_cast<Pkt_t*>(umem + (addr & ~(Pkt_t::FRAME_SIZE - 1))); }
+
+    void loopback(Pkt_t*& pkt);
+    void stage(Xsk& xsk, msg::node_t target, Pkt_t*& pkt);
+    void flush(Xsk& xsk);
+    void reap(Xsk& xsk);
+    void refill(Xsk& xsk, uint32_t n);
+
+    void receive_loop(std::stop_token token);
+    void sample_stats(std::vector<std::pair<std::string, uint64_t>>& samples);
+};
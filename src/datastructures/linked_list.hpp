@@ -1,9 +1,13 @@
 #pragma once
 
 
-#include "db/mempools.hpp"
+#include "db/spinlock.hpp"
 
+#include <cstddef>
 #include <iostream>
+#include <memory>
+#include <mutex>
+#include <vector>
 
 
 template <typename T>
@@ -17,10 +21,92 @@ struct LinkedList {
         }
     };
 
+    // Nodes are recycled through per-thread free lists, linked by Node::next.
+    // A thread that frees more than it allocates (e.g. grants waiters of other
+    // threads) passes batches on to a shared depot, an empty one takes a batch
+    // from there or allocates new nodes. There is no upper limit.
+    class NodePool {
+        static constexpr std::size_t BATCH = 64;
+
+        struct FreeList {
+            Node* head = nullptr;
+            std::size_t size = 0;
+        };
+
+        struct Depot {
+            SpinLock mutex;
+            std::vector<Node*> batches;                  // free lists of BATCH nodes
+            std::vector<std::unique_ptr<Node[]>> chunks; // owns all nodes
+        };
+
+        static FreeList& local() {
+            static thread_local FreeList list;
+            return list;
+        }
+
+        static Depot& depot() {
+            static Depot depot;
+            return depot;
+        }
+
+    public:
+        static Node* allocate() {
+            auto& list = local();
+            if (!list.head) [[unlikely]] {
+                refill(list);
+            }
+            Node* node = list.head;
+            list.head = node->next;
+            --list.size;
+            return node;
+        }
+
+        static void deallocate(Node* node) {
+            auto& list = local();
+            node->next = list.head;
+            list.head = node;
+            if (++list.size >= 2 * BATCH) [[unlikely]] {
+                spill(list);
+            }
+        }
+
+    private:
+        static void refill(FreeList& list) {
+            auto& d = depot();
+            const std::lock_guard<SpinLock> lock(d.mutex);
+            if (!d.batches.empty()) {
+                list.head = d.batches.back();
+                list.size = BATCH;
+                d.batches.pop_back();
+                return;
+            }
+            auto& chunk = d.chunks.emplace_back(std::make_unique<Node[]>(BATCH));
+            for (std::size_t i = 0; i < BATCH; ++i) {
+                chunk[i].next = (i + 1 < BATCH) ? &chunk[i + 1] : nullptr;
+            }
+            list.head = &chunk[0];
+            list.size = BATCH;
+        }
+
+        static void spill(FreeList& list) {
+            Node* first = list.head;
+            Node* last = first;
+            for (std::size_t i = 1; i < BATCH; ++i) {
+                last = last->next;
+            }
+            list.head = last->next;
+            list.size -= BATCH;
+            last->next = nullptr;
+
+            auto& d = depot();
+            const std::lock_guard<SpinLock> lock(d.mutex);
+            d.batches.push_back(first);
+        }
+    };
+
 
-    static inline FixedThreadsafeMempool<Node> pool{4096};
-    // FixedMempool<Node> pool{80};
     Node* head = nullptr;
+    Node* tail = nullptr; // appending in order is O(1)
 
     ~LinkedList() {
         if (!empty()) {
@@ -34,9 +120,16 @@ struct LinkedList {
     }
 
     void add_sorted(T&& val) {
-        Node* node = pool.allocate();
+        Node* node = NodePool::allocate();
         node->val = val;
 
+        if (!head || *tail < *node) { // e.g. owners arrive mostly by ascending ts
+            node->next = nullptr;
+            (head ? tail->next : head) = node;
+            tail = node;
+            return;
+        }
+
         Node** pp = &head;
         while (*pp && **pp < *node) {
             pp = &(*pp)->next;
@@ -48,12 +141,13 @@ struct LinkedList {
     template <typename Fn>
     void remove_if(Fn&& fn) {
         Node** pp = &head;
+        Node* prev = nullptr;
         while (*pp) {
             Node* node = *pp;
             if (fn(node->val)) {
-                *pp = node->next;
-                pool.deallocate(node);
+                unlink(pp, prev, node);
             } else {
+                prev = node;
                 pp = &(node->next);
             }
         }
@@ -63,13 +157,14 @@ struct LinkedList {
     template <typename Fn>
     void remove_if_one(Fn&& fn) {
         Node** pp = &head;
+        Node* prev = nullptr;
         while (*pp) {
             Node* node = *pp;
             if (fn(node->val)) {
-                *pp = node->next;
-                pool.deallocate(node);
+                unlink(pp, prev, node);
                 break;
             } else {
+                prev = node;
                 pp = &(node->next);
             }
         }
@@ -78,19 +173,26 @@ struct LinkedList {
 
     template <typename Fn>
     void remove_until(Fn&& fn) {
-        Node** pp = &head;
-        while (*pp) {
-            Node* node = *pp;
+        while (head) {
+            Node* node = head;
             bool rm = fn(node->val);
             if (!rm) {
                 break;
             }
-            *pp = node->next;
-            pool.deallocate(node);
+            unlink(&head, nullptr, node);
         }
     }
 
     bool empty() {
         return head == nullptr;
     }
+
+private:
+    void unlink(Node** pp, Node* prev, Node* node) {
+        *pp = node->next;
+        if (node == tail) {
+            tail = prev;
+        }
+        NodePool::deallocate(node);
+    }
 };
@@ -0,0 +1,53 @@
+#pragma once
+
+#include "db/types.hpp"
+
+#include <chrono>
+#include <cstdint>
+#include <random>
+
+
+// Schedules transaction arrivals for open-loop runs. Arrivals are independent
+// of completions, so a worker that falls behind accumulates queueing delay
+// which is included in the measured latency (no coordinated omission).
+class ArrivalProcess {
+public:
+    using clock = std::chrono::steady_clock;
+
+private:
+    std::mt19937_64 gen;
+    std::exponential_distribution<double> exp_dist{1.0};
+    const ArrivalType type;
+    const double interval_ns; // mean inter-arrival time
+    double next_ns = 0.0;     // relative to start, keeps sub-ns precision
+    clock::time_point start_time;
+
+public:
+    ArrivalProcess(ArrivalType type, uint64_t rate, uint64_t seed)
+        : gen(seed), type(type), interval_ns(rate > 0 ? 1e9 / rate : 0.0) {}
+
+    void start(clock::time_point now) {
+        start_time = now;
+        next_ns = 0.0;
+    }
+
+    // returns scheduled arrival of the next transaction
+    clock::time_point next() {
+        auto arrival = start_time + std::chrono::nanoseconds{static_cast<int64_t>(next_ns)};
+        switch (type) {
+            case ArrivalType::CONSTANT:
+                next_ns += interval_ns;
+                break;
+            case ArrivalType::POISSON:
+                next_ns += exp_dist(gen) * interval_ns;
+                break;
+        }
+        return arrival;
+    }
+
+    static void wait_until(clock::time_point arrival) {
+        while (clock::now() < arrival) {
+            __builtin_ia32_pause();
+        }
+    }
+};
@@ -33,11 +33,32 @@ void Config::parse_cli(int argc, char** argv) {
         ("num_txn_workers", "", cxxopts::value<uint32_t>())
         ("csv_file_cycles", "", cxxopts::value<std::string>())
         ("csv_file_periodic", "", cxxopts::value<std::string>())
+        ("csv_file_heatmap", "Prefix for per-table key access heatmaps", cxxopts::value<std::string>())
+        ("trace_file", "Write a Chrome trace (json) of txn phases per thread", cxxopts::value<std::string>())
+        ("metrics_socket", "Serve live metrics (Prometheus text format) on this Unix socket", cxxopts::value<std::string>())
+        ("metrics_port", "Serve live metrics over HTTP on this localhost port", cxxopts::value<uint16_t>())
+        ("local_cluster", "Run all num_nodes nodes as processes on this host (build with -Dcomm=shm)", cxxopts::value<bool>()->default_value("false"))
+        ("shm_name", "Name of the shared memory region of the shm transport", cxxopts::value<std::string>())
+        ("udp_busy_poll_us", "SO_BUSY_POLL time of the udp transport sockets, 0 = off", cxxopts::value<int>()->default_value("0"))
+        ("udp_rx_sockets", "SO_REUSEPORT sockets the udp transport receives on, the kernel spreads flows over them", cxxopts::value<uint16_t>()->default_value("1"))
+        ("xdp_iface", "Interface of the xdp transport, needs num_txn_workers+2 queues from xdp_queue on", cxxopts::value<std::string>())
+        ("xdp_queue", "First queue id used by the xdp transport", cxxopts::value<uint32_t>()->default_value("0"))
+        ("msg_timeout_us", "Resend unanswered remote requests after this many µs, 0 = wait forever", cxxopts::value<uint32_t>()->default_value("0"))
+        ("msg_retries", "Resends of a remote lock request before the txn aborts", cxxopts::value<uint32_t>()->default_value("3"))
+        ("drop_rate", "Fault injection: drop this fraction of received tuple messages (needs msg_timeout_us)", cxxopts::value<double>()->default_value("0"))
+        ("ship_fragments", "Function shipping: run txn fragments at the node owning the tuple", cxxopts::value<bool>()->default_value("false"))
+        ("async_commit", "Start the next txn without waiting until remote locks are released, only rows with a pending release block", cxxopts::value<bool>()->default_value("false"))
+        ("zero_copy_bytes", "dpdk: remote reads of tuples with at least this many bytes attach the row to the reply instead of copying it, 0 = off", cxxopts::value<uint32_t>()->default_value("0"))
+        ("stats", "Active stats, e.g. counter,cycles,periodic,aborts (all, none); SIGUSR1 toggles them", cxxopts::value<StatsBitmask>())
 
         ("workload", "", cxxopts::value<BenchmarkType>())
         ("use_switch", "Whether to use switch for txn processing", cxxopts::value<bool>())
         ("verify", "Run verification, like table consistency checks for TPC-C ", cxxopts::value<bool>()->default_value("false"))
-        ("num_txns", "", cxxopts::value<uint64_t>())
+        ("num_txns", "Transactions per worker, upper bound if duration_s is set", cxxopts::value<uint64_t>())
+        ("duration_s", "Run each worker for this many seconds, 0 = until num_txns", cxxopts::value<uint64_t>()->default_value("0"))
+        ("arrival_rate", "Open-loop target txns/s per worker, 0 = closed-loop", cxxopts::value<uint64_t>()->default_value("0"))
+        ("arrival", "Open-loop arrival process: poisson or constant", cxxopts::value<ArrivalType>())
+        ("abort_sample_rate", "Keep every n-th abort record for aborts.csv, 0 = off", cxxopts::value<uint64_t>()->default_value("0"))
 
         ("ycsb_table_size", "", cxxopts::value<uint64_t>())
         ("ycsb_write_prob", "", cxxopts::value<int>())
@@ -67,9 +88,57 @@ void Config::parse_cli(int argc, char** argv) {
         std::exit(0);
     }
 
-    node_id = result.as<uint32_t>("node_id");
+    local_cluster = result.as<bool>("local_cluster");
+    if (local_cluster) {
+#ifndef P4DB_COMM_SHM
+        throw std::runtime_error("Please build with -Dcomm=shm for local_cluster");
+#endif
+        node_id = 0; // set per forked process
+    } else {
+        node_id = result.as<uint32_t>("node_id");
+    }
     num_nodes = result.as<uint32_t>("num_nodes");
     num_txn_workers = result.as<uint32_t>("num_txn_workers");
+    if (num_nodes >= 255 || num_txn_workers >= 255) { // msg::node_t has 8 bits each, plus switch and msg-handler
+        throw std::invalid_argument("num_nodes and num_txn_workers must be < 255");
+    }
+    if (result.count("shm_name")) {
+        shm_name = result.as<std::string>("shm_name");
+    }
+    udp_busy_poll_us = result.as<int>("udp_busy_poll_us");
+    udp_rx_sockets = result.as<uint16_t>("udp_rx_sockets");
+    if (udp_rx_sockets == 0) {
+        throw std::invalid_argument("udp_rx_sockets must be > 0");
+    }
+    if (result.count("xdp_iface")) {
+        xdp_iface = result.as<std::string>("xdp_iface");
+    }
+    xdp_queue = result.as<uint32_t>("xdp_queue");
+#ifdef P4DB_COMM_XDP
+    if (xdp_iface.empty()) {
+        throw std::invalid_argument("xdp transport needs --xdp_iface");
+    }
+#endif
+    msg_timeout_us = result.as<uint32_t>("msg_timeout_us");
+    msg_retries = result.as<uint32_t>("msg_retries");
+    drop_rate = result.as<double>("drop_rate");
+    if (drop_rate < 0.0 || drop_rate >= 1.0) {
+        throw std::invalid_argument("drop_rate must be in [0, 1)");
+    }
+    if (drop_rate > 0.0 && msg_timeout_us == 0) {
+        throw std::invalid_argument("drop_rate needs msg_timeout_us, lost messages are never resent otherwise");
+    }
+    ship_fragments = result.as<bool>("ship_fragments");
+    async_commit = result.as<bool>("async_commit");
+    zero_copy_bytes = result.as<uint32_t>("zero_copy_bytes");
+    if (zero_copy_bytes > 0) {
+#if defined(P4DB_COMM_SHM) || defined(P4DB_COMM_UDP) || defined(P4DB_COMM_URING) || defined(P4DB_COMM_XDP)
+        throw std::invalid_argument("zero_copy_bytes needs the dpdk transport");
+#endif
+        if (msg_timeout_us > 0) { // the ReplyCache stores replies as one buffer
+            throw std::invalid_argument("zero_copy_bytes does not support msg_timeout_us");
+        }
+    }
 
 
     if (result.count("servers")) {
@@ -78,9 +147,11 @@ void Config::parse_cli(int argc, char** argv) {
         servers = result.as<std::vector<Server>>("servers");
     }
 
+#ifndef P4DB_COMM_SHM // shm addresses nodes by node_id only
     if (servers.size() < num_nodes) {
         throw std::runtime_error("Insufficient servers specified");
     }
+#endif
     servers.resize(num_nodes);
 
     if (result.count("csv_file_cycles")) {
@@ -89,9 +160,46 @@ void Config::parse_cli(int argc, char** argv) {
         }
         csv_file_cycles = result.as<std::string>("csv_file_cycles");
     }
+    if (result.count("csv_file_heatmap")) {
+        if constexpr (!(ENABLED_STATS & StatsBitmask::HEATMAP)) {
+            throw std::runtime_error("Please compile with ENABLED_STATS|=StatsBitmask::HEATMAP");
+        }
+        csv_file_heatmap = result.as<std::string>("csv_file_heatmap");
+    }
+    if (result.count("stats")) {
+        stats = result.as<StatsBitmask>("stats");
+        if (stats == StatsBitmask::ALL) {
+            stats = ENABLED_STATS;
+        }
+        for (auto& [name, bit] : STATS_NAMES) {
+            if ((stats & bit) && !(ENABLED_STATS & bit)) {
+                throw std::runtime_error("Please compile with " + std::string{name} + " in ENABLED_STATS");
+            }
+        }
+    }
+    if (result.count("metrics_socket")) {
+        metrics_socket = result.as<std::string>("metrics_socket");
+    }
+    if (result.count("metrics_port")) {
+        metrics_port = result.as<uint16_t>("metrics_port");
+        if (!metrics_socket.empty()) {
+            throw std::invalid_argument("metrics_socket and metrics_port are exclusive");
+        }
+    }
+    if (result.count("trace_file")) {
+        if constexpr (!(ENABLED_STATS & StatsBitmask::TRACE)) {
+            throw std::runtime_error("Please compile with ENABLED_STATS|=StatsBitmask::TRACE");
+        }
+        trace_file = result.as<std::string>("trace_file");
+    }
 
 
     use_switch = result.as<bool>("use_switch");
+#if defined(P4DB_COMM_SHM) || defined(P4DB_COMM_UDP) || defined(P4DB_COMM_URING) || defined(P4DB_COMM_XDP)
+    if (use_switch) { // only the dpdk transport addresses the switch
+        throw std::invalid_argument("use_switch needs the dpdk transport");
+    }
+#endif
     if (result.count("verify")) {
         verify = result.as<bool>("verify");
     }
@@ -101,6 +209,21 @@ void Config::parse_cli(int argc, char** argv) {
     // }
 
     num_txns = result.as<uint64_t>("num_txns");
+    if (result.count("duration_s")) {
+        duration_s = result.as<uint64_t>("duration_s");
+    }
+    if (result.count("arrival_rate")) {
+        arrival_rate = result.as<uint64_t>("arrival_rate");
+    }
+    if (result.count("arrival")) {
+        arrival = result.as<ArrivalType>("arrival");
+    }
+    if (result.count("abort_sample_rate")) {
+        if constexpr (!(ENABLED_STATS & StatsBitmask::ABORTS)) {
+            throw std::runtime_error("Please compile with ENABLED_STATS|=StatsBitmask::ABORTS");
+        }
+        abort_sample_rate = result.as<uint64_t>("abort_sample_rate");
+    }
 
     if (result.count("switch_entries")) {
         switch_entries = result.as<uint64_t>("switch_entries");
@@ -172,7 +295,7 @@ void Config::parse_cli(int argc, char** argv) {
             if (tpcc.num_warehouses % num_nodes != 0) {
                 throw std::invalid_argument("tpcc_num_warehouses % num_nodes != 0");
             }
-            tpcc.home_w_id = node_id * tpcc.num_warehouses / num_nodes;
+            set_node_id(node_id); // home_w_id
             tpcc.num_districts = tpcc.num_warehouses * DISTRICTS_PER_WAREHOUSE;
             if (result.count("tpcc_new_order_remote_prob")) {
                 tpcc.new_order_remote_prob = result.as<int>("tpcc_new_order_remote_prob");
@@ -209,14 +332,41 @@ void Config::parse_cli(int argc, char** argv) {
     }
 }
 
+void Config::set_node_id(uint32_t id) {
+    node_id = id;
+    if (workload == BenchmarkType::TPCC) {
+        tpcc.home_w_id = node_id * tpcc.num_warehouses / num_nodes;
+    }
+}
+
 void Config::print() {
     std::stringstream ss;
     ss << std::boolalpha;
     ss << "node_id=" << node_id << '\n';
     ss << "num_nodes=" << num_nodes << '\n';
     ss << "num_txn_workers=" << num_txn_workers << '\n';
+    ss << "local_cluster=" << local_cluster << '\n';
     ss << "num_txns=" << num_txns << '\n';
+    ss << "duration_s=" << duration_s << '\n';
+    ss << "arrival_rate=" << arrival_rate << '\n';
+    ss << "arrival=" << arrival << '\n';
+    ss << "abort_sample_rate=" << abort_sample_rate << '\n';
+    ss << "msg_timeout_us=" << msg_timeout_us << '\n';
+    ss << "msg_retries=" << msg_retries << '\n';
+    ss << "drop_rate=" << drop_rate << '\n';
+    ss << "ship_fragments=" << ship_fragments << '\n';
+    ss << "async_commit=" << async_commit << '\n';
+    ss << "zero_copy_bytes=" << zero_copy_bytes << '\n';
+    ss << "stats=" << stats << '\n';
+    ss << "metrics_socket=" << metrics_socket << '\n';
+    ss << "metrics_port=" << metrics_port << '\n';
     ss << "csv_file_cycles=" << csv_file_cycles << '\n';
+    if constexpr (ENABLED_STATS & StatsBitmask::HEATMAP) {
+        ss << "csv_file_heatmap=" << csv_file_heatmap << '\n';
+    }
+    if constexpr (ENABLED_STATS & StatsBitmask::TRACE) {
+        ss << "trace_file=" << trace_file << '\n';
+    }
     ss << "cc_scheme=" << CC_SCHEME << '\n';
     ss << "use_switch=" << use_switch << '\n';
     ss << "switch_no_conflict=" << SWITCH_NO_CONFLICT << '\n';
@@ -19,6 +19,7 @@ protected:
 public:
     void parse_cli(int argc, char** argv);
     void print();
+    void set_node_id(uint32_t id); // also updates values derived from it
 
 
     std::vector<Server> servers = {};
@@ -31,9 +32,30 @@ public:
 
     BenchmarkType workload;
     uint64_t num_txns;
+    uint64_t duration_s = 0;
+    uint64_t arrival_rate = 0; // per worker txns/s, 0 = closed-loop
+    ArrivalType arrival = ArrivalType::POISSON;
+    uint64_t abort_sample_rate = 0; // keep every n-th abort record, 0 = off
+    StatsBitmask stats = StatsBitmask::CYCLES; // active at start, e.g. --stats cycles,aborts, see stats::Toggle
     bool use_switch;
     bool verify;
+    bool local_cluster = false;  // fork num_nodes processes, needs -Dcomm=shm
+    std::string shm_name{"/p4db"}; // shm_open name of the shm transport rings
+    int udp_busy_poll_us = 0;        // SO_BUSY_POLL of the udp transport, 0 = off
+    uint16_t udp_rx_sockets = 1;     // SO_REUSEPORT sockets of the udp transport
+    std::string xdp_iface;           // interface of the xdp transport
+    uint32_t xdp_queue = 0;          // first queue id used by the xdp transport
+    uint32_t msg_timeout_us = 0;     // resend remote requests after this, 0 = wait forever
+    uint32_t msg_retries = 3;        // resends before a remote access aborts
+    double drop_rate = 0.0;          // fault injection, fraction of received tuple msgs dropped
+    bool ship_fragments = false;     // run fragments at the owner of a remote tuple (TransactionBase::call)
+    bool async_commit = false;       // commit without waiting for the TuplePutRes of remote releases
+    uint32_t zero_copy_bytes = 0;    // dpdk: attach tuples of this size or larger to replies instead of copying, 0 = off
     std::string csv_file_cycles{"cycles.csv"};
+    std::string csv_file_heatmap{"heatmap"}; // prefix, one <prefix>_<table>.csv per table
+    std::string trace_file; // chrome trace json, empty = no tracing
+    std::string metrics_socket; // unix socket path for live metrics
+    uint16_t metrics_port = 0;  // localhost http port for live metrics, 0 = off
 
     struct YCSB {
         uint64_t table_size;
@@ -2,9 +2,13 @@
 
 #include "comm/comm.hpp"
 #include "comm/msg_handler.hpp"
+#include "db/config.hpp"
+#include "stats/collector.hpp"
 #include "table/table.hpp"
 
+#include <fstream>
 #include <memory>
+#include <sstream>
 #include <string>
 #include <thread>
 #include <unordered_map>
@@ -32,6 +36,9 @@ public:
     Database(const Database&) = delete;
 
     ~Database() {
+        if constexpr (ENABLED_STATS & StatsBitmask::HEATMAP) {
+            write_heatmaps();
+        }
         for (auto& table : table_ids) {
             delete table;
         }
@@ -42,12 +49,18 @@ public:
         if (has_table(key)) {
             throw std::logic_error("Table already present in database");
         }
+        if (table_ids.size() >= msg::wire::MAX_TABLES) {
+            throw std::logic_error("Too many tables for the 16 bit table ids of tuple messages");
+        }
         std::cout << "Allocating Table: " << key << '\n';
         auto table = new T{std::forward<Args>(args)..., *comm};
         table->id = p4db::table_t{table_ids.size()};
         table->name = key;
         table_ids.emplace_back(table);
         table_names[key] = table;
+        if constexpr (ENABLED_STATS & StatsBitmask::ABORTS) {
+            stats::StatsCollector::get().set_table_name(table->id, key);
+        }
         return table;
     }
 
@@ -61,6 +74,22 @@ public:
         return table_names.find(name) != table_names.end();
     }
 
+    void write_heatmaps() {
+        auto& config = Config::instance();
+        std::stringstream ss;
+        ss << "*** Hot Set Estimate ***\n";
+        for (auto& table : table_ids) {
+            std::ofstream csv{config.csv_file_heatmap + '_' + table->name + ".csv"};
+            csv << "node_id,table,first_index,last_index,accesses,conflicts\n";
+            table->sketch.write_csv(csv, config.node_id, table->name);
+
+            ss << table->name << ": hot50=" << table->sketch.hot_set_size(0.5)
+               << " hot90=" << table->sketch.hot_set_size(0.9)
+               << " hot99=" << table->sketch.hot_set_size(0.99) << " rows\n";
+        }
+        std::cout << ss.str();
+    }
+
     template <typename T>
     void get_casted(std::string key, T*& dest) {
         dest = dynamic_cast<T*>((*this)[key]);
@@ -2,8 +2,14 @@
 
 #include "db/types.hpp"
 
+#include <algorithm>
+#include <array>
 #include <cstdint>
 #include <iostream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <utility>
 
 
 using namespace std::chrono_literals;
@@ -18,6 +24,10 @@ enum class StatsBitmask : uint64_t {
     COUNTER = 0x01,
     CYCLES = 0x02,
     PERIODIC = 0x04,
+    ABORTS = 0x08,
+    HEATMAP = 0x10,
+    TRACE = 0x20,
+    PERF = 0x40,
 
     ALL = 0xffffffffffffffff,
 };
@@ -29,14 +39,71 @@ constexpr bool operator&(StatsBitmask lhs, StatsBitmask rhs) {
     using T = std::underlying_type<StatsBitmask>::type;
     return static_cast<T>(lhs) & static_cast<T>(rhs);
 }
+// switchable at runtime, see stats::Toggle
+constexpr std::array<std::pair<std::string_view, StatsBitmask>, 4> STATS_NAMES{{
+    {"counter", StatsBitmask::COUNTER},
+    {"cycles", StatsBitmask::CYCLES},
+    {"periodic", StatsBitmask::PERIODIC},
+    {"aborts", StatsBitmask::ABORTS},
+}};
+// only compiled in via ENABLED_STATS, then controlled by other options
+constexpr std::array<std::pair<std::string_view, std::string_view>, 3> STATS_COMPILE_TIME{{
+    {"heatmap", "--csv_file_heatmap"},
+    {"trace", "--trace_file"},
+    {"perf", "ENABLED_STATS, counters are read whenever compiled in (needs /sys/devices/cpu/rdpmc)"},
+}};
+// comma separated names, "none" or "all"
+inline std::istream& operator>>(std::istream& is, StatsBitmask& mask) {
+    mask = StatsBitmask::NONE;
+    std::string list;
+    is >> list;
+    for (std::size_t pos = 0; pos <= list.size();) {
+        auto end = std::min(list.find(',', pos), list.size());
+        auto s = std::string_view{list}.substr(pos, end - pos);
+        pos = end + 1;
+        if (s == "none") {
+            continue;
+        }
+        if (s == "all") {
+            mask = StatsBitmask::ALL;
+            continue;
+        }
+        auto ct = std::find_if(STATS_COMPILE_TIME.begin(), STATS_COMPILE_TIME.end(), [&](auto& e) { return e.first == s; });
+        if (ct != STATS_COMPILE_TIME.end()) {
+            throw std::invalid_argument(std::string{s} + " stats cannot be switched by --stats, see " + std::string{ct->second});
+        }
+        auto it = std::find_if(STATS_NAMES.begin(), STATS_NAMES.end(), [&](auto& e) { return e.first == s; });
+        if (it == STATS_NAMES.end()) {
+            throw std::invalid_argument("Could not parse StatsBitmask.");
+        }
+        mask = mask | it->second;
+    }
+    return is;
+}
+inline std::ostream& operator<<(std::ostream& os, const StatsBitmask& mask) {
+    bool first = true;
+    for (auto& [name, bit] : STATS_NAMES) {
+        if (mask & bit) {
+            os << (first ? "" : ",") << name;
+            first = false;
+        }
+    }
+    if (first) {
+        os << "none";
+    }
+    return os;
+}
 
 // constexpr StatsBitmask ENABLED_STATS = StatsBitmask::COUNTER | StatsBitmask::CYCLES | StatsBitmask::PERIODIC;
 
-constexpr StatsBitmask ENABLED_STATS = StatsBitmask::CYCLES;
+// compiled-in stats, which of them are active is chosen at runtime (--stats, SIGUSR1)
+constexpr StatsBitmask ENABLED_STATS = StatsBitmask::COUNTER | StatsBitmask::CYCLES | StatsBitmask::PERIODIC | StatsBitmask::ABORTS;
 constexpr bool STATS_PER_WORKER = false;
 constexpr auto STATS_CYCLE_SAMPLE_TIME = 10ms; //100us;
 constexpr auto STATS_PERIODIC_SAMPLE_TIME = 500ms;
 constexpr auto PERIODIC_CSV_FILENAME = "periodic.csv";
+constexpr auto CYCLES_PERIODIC_CSV_FILENAME = "cycles_periodic.csv";
+constexpr auto ABORTS_CSV_FILENAME = "aborts.csv";
 constexpr auto SINGLE_NUMA = false;
 
 
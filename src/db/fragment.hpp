@@ -0,0 +1,79 @@
+#pragma once
+
+#include "db/types.hpp"
+
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+
+
+// Stored fragment procedures for function shipping (see TransactionBase::call).
+// A fragment is a struct like
+//
+//     struct DepositChecking {
+//         static constexpr uint16_t ID = 1;            // unique per benchmark
+//         static constexpr AccessMode::value_t MODE = AccessMode::WRITE;
+//         using Tuple_t = Checking;
+//         struct Args { int32_t val; };
+//         struct Result { int32_t balance; };
+//         static bool apply(Tuple_t& tuple, const Args& args, Result& result);
+//     };
+//
+// apply runs on the locked tuple at its owner, returning false refuses the
+// fragment (the tuple must be unchanged then) and aborts the txn. Every node
+// registers the same fragments before its workers start.
+namespace fragments {
+
+static constexpr std::size_t MAX_FRAGMENTS = 64;
+static constexpr std::size_t MAX_ARGS = 256; // bytes
+
+struct Entry {
+    bool (*apply)(void* tuple, const uint8_t* args, uint8_t* result) = nullptr;
+    uint16_t args_size = 0;
+    uint16_t result_size = 0;
+};
+
+
+class Registry {
+    std::array<Entry, MAX_FRAGMENTS> entries{};
+
+public:
+    static Registry& get() {
+        static Registry registry;
+        return registry;
+    }
+
+    template <typename Fragment>
+    void add() {
+        using Args = typename Fragment::Args;
+        using Result = typename Fragment::Result;
+        static_assert(Fragment::ID < MAX_FRAGMENTS);
+        static_assert(sizeof(Args) <= MAX_ARGS);
+        static_assert(std::is_trivially_copyable_v<Args> && std::is_trivially_copyable_v<Result>);
+
+        entries[Fragment::ID] = Entry{
+            [](void* tuple, const uint8_t* args, uint8_t* result) {
+                Args a;
+                Result r{};
+                std::memcpy(&a, args, sizeof(a));
+                bool applied = Fragment::apply(*static_cast<typename Fragment::Tuple_t*>(tuple), a, r);
+                std::memcpy(result, &r, sizeof(r));
+                return applied;
+            },
+            sizeof(Args),
+            sizeof(Result),
+        };
+    }
+
+    const Entry& at(uint16_t id) const {
+        if (id >= MAX_FRAGMENTS || !entries[id].apply) [[unlikely]] {
+            throw std::runtime_error("fragment " + std::to_string(id) + " not registered");
+        }
+        return entries[id];
+    }
+};
+
+} // namespace fragments
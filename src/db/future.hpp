@@ -5,7 +5,11 @@
 #include "db/errors.hpp"
 
 #include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
 #include <limits>
+#include <stdexcept>
 
 
 struct AbstractFuture {
@@ -23,6 +27,17 @@ struct AbstractFuture {
         }
         return pkt;
     }
+
+    // false if no pkt arrived before the deadline
+    bool wait_until(std::chrono::steady_clock::time_point deadline) {
+        while (!this->pkt.load(std::memory_order_relaxed)) {
+            if (std::chrono::steady_clock::now() >= deadline) [[unlikely]] {
+                return false;
+            }
+            __builtin_ia32_pause();
+        }
+        return true;
+    }
 };
 
 
@@ -48,6 +63,10 @@ struct TupleFuture final : public AbstractFuture {
         return wait();
     }
 
+    void fail() {
+        tuple = EXCEPTION;
+    }
+
 private:
     Tuple_t* wait() {
         while (true) {
@@ -74,14 +93,60 @@ private:
 };
 
 
+// Result of a fragment (see db/fragment.hpp), points into the TupleCallRes or
+// to local if the fragment ran on this node. get() fails if the lock was not
+// granted or the fragment refused, refused tells both apart.
+template <typename Result_t>
+struct CallFuture final : public AbstractFuture {
+    static inline Result_t* EXCEPTION = reinterpret_cast<Result_t*>(0xffffffff'ffffffff);
+
+    std::atomic<Result_t*> result{nullptr};
+    bool refused = false;
+    Result_t local;
+
+    // not threadsafe
+    Result_t* get() {
+        if (result == EXCEPTION) [[unlikely]] {
+            return nullptr;
+        } else if (result) [[likely]] {
+            return result;
+        }
+
+        auto pkt = get_pkt();
+        auto res = pkt->as<msg::TupleCallRes>();
+        if (res->mode == AccessMode::INVALID || !res->applied) [[unlikely]] {
+            refused = res->mode != AccessMode::INVALID;
+            result = EXCEPTION;
+            pkt->free();
+            return nullptr;
+        }
+        result = reinterpret_cast<Result_t*>(res->result);
+        return result;
+    }
+
+    void fail() {
+        result = EXCEPTION;
+    }
+};
+
+
+// A switch txn is neither resent nor rolled back, it is not idempotent and
+// the switch may have executed it even if the reply got lost. A reply missing
+// after the timeout leaves the outcome unknown, which is fatal: counting it as
+// abort or commit could silently diverge from the switch registers.
 template <typename Parse_fn>
 struct SwitchFuture final : public AbstractFuture {
     Parse_fn parse_fn;
+    std::chrono::microseconds timeout; // 0 = wait forever
 
-    SwitchFuture(Parse_fn&& parse_fn)
-        : AbstractFuture{}, parse_fn(parse_fn) {}
+    SwitchFuture(Parse_fn&& parse_fn, std::chrono::microseconds timeout = {})
+        : AbstractFuture{}, parse_fn(parse_fn), timeout(timeout) {}
 
     const auto get() { // can be only called once
+        if (timeout.count() > 0 && !wait_until(std::chrono::steady_clock::now() + timeout)) [[unlikely]] {
+            std::cerr << "SwitchTxn reply lost after " << timeout.count() << " us, outcome unknown, aborting\n";
+            std::abort();
+        }
         auto pkt = get_pkt();
         auto ret = parse_fn(pkt);
         pkt->free();
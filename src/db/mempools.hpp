@@ -12,23 +12,98 @@
 #include <vector>
 
 
-template <std::size_t max_size>
-struct StackPool {
-    size_t size = 0;
-    uint8_t buffer[max_size];
+// Bump allocator for objects that live until the end of a txn, their
+// destructors are never run. Grows by blocks from a per-thread free list,
+// clear() keeps the first block and hands the others back in O(1).
+class Arena {
+public:
+    static constexpr std::size_t BLOCK_SIZE = 64 * 1024;
+    static constexpr std::size_t MAX_ALIGN = 64;
+
+private:
+    struct Block {
+        Block* next = nullptr;
+        alignas(MAX_ALIGN) uint8_t data[BLOCK_SIZE - MAX_ALIGN];
+    };
+    static_assert(sizeof(Block) == BLOCK_SIZE);
+
+    // blocks of the arenas of this thread, freed when it exits
+    struct FreeList {
+        Block* head = nullptr;
+
+        ~FreeList() {
+            while (head) {
+                delete std::exchange(head, head->next);
+            }
+        }
 
-    template <typename T, typename... Args>
-    auto allocate(Args&&... args) {
-        if ((size + sizeof(T)) > max_size) {
-            throw std::runtime_error("StackPool overflow");
+        Block* pop() {
+            if (!head) {
+                return new Block;
+            }
+            auto block = std::exchange(head, head->next);
+            block->next = nullptr;
+            return block;
+        }
+
+        void push(Block* first, Block* last) {
+            last->next = head;
+            head = first;
         }
-        auto ptr = new (buffer + size) T{std::forward<Args>(args)...};
-        size += sizeof(T);
-        return ptr;
+    };
+    static FreeList& free_blocks() {
+        static thread_local FreeList list;
+        return list;
+    }
+
+    Block* first;
+    Block* current;
+    uintptr_t pos;
+    uintptr_t end;
+
+public:
+    Arena() : first(free_blocks().pop()), current(first) {
+        reset_to(first);
+    }
+
+    ~Arena() {
+        free_blocks().push(first, current);
+    }
+
+    Arena(const Arena&) = delete;
+    Arena& operator=(const Arena&) = delete;
+
+    template <typename T, typename... Args>
+    T* allocate(Args&&... args) {
+        static_assert(sizeof(T) <= sizeof(Block::data) && alignof(T) <= MAX_ALIGN, "T does not fit into an Arena block");
+        return new (bump(sizeof(T), alignof(T))) T{std::forward<Args>(args)...};
     }
 
     void clear() {
-        size = 0;
+        if (current != first) [[unlikely]] {
+            free_blocks().push(first->next, current);
+            first->next = nullptr;
+            current = first;
+        }
+        reset_to(first);
+    }
+
+private:
+    void* bump(std::size_t size, std::size_t align) {
+        uintptr_t p = (pos + align - 1) & ~(align - 1);
+        if (p + size > end) [[unlikely]] {
+            current->next = free_blocks().pop();
+            reset_to(current->next);
+            p = pos; // blocks are MAX_ALIGN aligned
+        }
+        pos = p + size;
+        return reinterpret_cast<void*>(p);
+    }
+
+    void reset_to(Block* block) {
+        current = block;
+        pos = reinterpret_cast<uintptr_t>(block->data);
+        end = pos + sizeof(block->data);
     }
 };
 
@@ -2,20 +2,32 @@
 
 #include "comm/msg.hpp"
 #include "comm/msg_handler.hpp"
+#include "db/arrival.hpp"
 #include "db/buffers.hpp"
 #include "db/database.hpp"
 #include "db/defs.hpp"
 #include "db/errors.hpp"
+#include "db/fragment.hpp"
 #include "db/future.hpp"
 #include "db/mempools.hpp"
 #include "db/ts_factory.hpp"
+#include "db/txn_generator.hpp"
 #include "db/types.hpp"
 #include "db/undolog.hpp"
 #include "db/util.hpp"
+#include "stats/collector.hpp"
 #include "stats/context.hpp"
+#include "stats/histogram.hpp"
 #include "table/table.hpp"
 
+#include <array>
+#include <chrono>
+#include <cstring>
 #include <iostream>
+#include <source_location>
+#include <string_view>
+#include <type_traits>
+#include <variant>
 #include <vector>
 
 
@@ -42,20 +54,28 @@ struct TransactionBase : crtp<T>, public Transaction, public TransactionArgs, pu
     using Table_t = typename TableInfo::Table_t<Tuple_t>;
 
     using Arg_t = typename TransactionArgs::Arg_t;
+    static_assert(std::variant_size_v<Arg_t> <= stats::Cycles::MAX_TXN_TYPES);
 
     Database& db;
     Undolog log;
-    StackPool<8192> mempool;
+    Arena mempool; // futures, until commit or rollback
     uint32_t tid;
 
     TimestampFactory ts_factory;
     timestamp_t ts;
 
+    std::chrono::microseconds msg_timeout; // 0 = remote requests are never resent
+    uint32_t msg_retries;
+    bool ship_fragments;
+
     TransactionBase(Database& db)
-        : db(db), log(db.comm.get()), tid(WorkerContext::get().tid) {}
+        : db(db), log(db.comm.get()), tid(WorkerContext::get().tid),
+          msg_timeout(Config::instance().msg_timeout_us), msg_retries(Config::instance().msg_retries),
+          ship_fragments(Config::instance().ship_fragments) {}
 
 
     RC execute(Arg_t& arg) {
+        WorkerContext::get().refresh_stats();
         ts = ts_factory.get();
         // std::stringstream ss;
         // ss << "Starting txn tid=" << tid << " ts=" << ts << '\n';
@@ -67,6 +87,9 @@ struct TransactionBase : crtp<T>, public Transaction, public TransactionArgs, pu
         WorkerContext::get().cycl.reset(stats::Cycles::local_latency);
         WorkerContext::get().cycl.reset(stats::Cycles::switch_txn_latency);
 
+        WorkerContext::get().cycl.set_txn_type(arg.index());
+        WorkerContext::get().aborts.clear_cause();
+        WorkerContext::get().trace.begin(stats::Trace::txn, arg.index());
         WorkerContext::get().cycl.start(stats::Cycles::commit_latency);
         return std::visit(this->underlying(), arg);
     }
@@ -86,10 +109,14 @@ struct TransactionBase : crtp<T>, public Transaction, public TransactionArgs, pu
         WorkerContext::get().cycl.save(stats::Cycles::switch_txn_latency);
 
         WorkerContext::get().pcntr.incr(stats::Periodic::commits);
+        WorkerContext::get().cycl.perf.commit();
+        WorkerContext::get().trace.end(stats::Trace::txn, RC::COMMIT);
         return RC::COMMIT;
     }
 
-    RC rollback() {
+    // default argument captures the call site, e.g. the check() in a txn
+    RC rollback(const std::source_location loc = std::source_location::current()) {
+        WorkerContext::get().aborts.record(loc);
         if constexpr (CC_SCHEME != CC_Scheme::NONE) {
             log.rollback(ts);
         }
@@ -99,6 +126,7 @@ struct TransactionBase : crtp<T>, public Transaction, public TransactionArgs, pu
         //     __builtin_ia32_pause();
         // }
 
+        WorkerContext::get().trace.end(stats::Trace::txn, RC::ROLLBACK);
         return RC::ROLLBACK;
     }
 
@@ -117,15 +145,18 @@ struct TransactionBase : crtp<T>, public Transaction, public TransactionArgs, pu
         }
 
         if (loc_info.is_local) {
+            auto span = WorkerContext::get().trace.scope(stats::Trace::local_lock, table->id);
             WorkerContext::get().cycl.start(stats::Cycles::local_latency);
             auto future = mempool.allocate<Future_t>();
             if (!table->get(key, AccessMode::READ, future, ts)) [[unlikely]] {
+                WorkerContext::get().aborts.set_cause(stats::Aborts::local, table->id, key, AccessMode::READ);
                 return nullptr;
             }
             if constexpr (CC_SCHEME != CC_Scheme::NONE) {
-                log.add_read(table, key, future); // TODO passing future necessary?
+                log.add_read(table, key);
             }
             if (!future->get()) [[unlikely]] {
+                WorkerContext::get().aborts.set_cause(stats::Aborts::local, table->id, key, AccessMode::READ);
                 return nullptr;
             } // make optional for NO_WAIT
             WorkerContext::get().cycl.stop(stats::Cycles::local_latency);
@@ -139,6 +170,8 @@ struct TransactionBase : crtp<T>, public Transaction, public TransactionArgs, pu
             }
         }
         WorkerContext::get().cycl.start(stats::Cycles::remote_latency);
+        auto span = WorkerContext::get().trace.scope(stats::Trace::remote_access, loc_info.target);
+        db.msg_handler->putresponses.wait_row(tid, table->id, key);
         auto pkt = db.comm->make_pkt();
         auto req = pkt->ctor<msg::TupleGetReq>(ts, table->id, key, mode);
         req->sender = db.comm->node_id;
@@ -147,13 +180,18 @@ struct TransactionBase : crtp<T>, public Transaction, public TransactionArgs, pu
         auto msg_id = db.msg_handler->set_new_id(req);
         db.msg_handler->add_future(msg_id, future);
 
+        const msg::TupleGetReq sent = *req; // for resends
         db.comm->send(loc_info.target, pkt, tid);
-        if constexpr (CC_SCHEME != CC_Scheme::NONE) {
-            log.add_remote_read(future, loc_info.target);
+        if (msg_timeout.count() > 0) {
+            await_remote(future, loc_info.target, sent, sizeof(sent));
         }
-        if (!future->get()) [[unlikely]] {
+        if (!future->get()) [[unlikely]] { // no lock, the pkt is freed already
+            WorkerContext::get().aborts.set_cause(stats::Aborts::remote, table->id, key, AccessMode::READ);
             return nullptr;
         }
+        if constexpr (CC_SCHEME != CC_Scheme::NONE) {
+            log.add_remote_read(future->get_pkt(), loc_info.target);
+        }
         WorkerContext::get().cycl.stop(stats::Cycles::remote_latency);
         return future;
     }
@@ -172,16 +210,19 @@ struct TransactionBase : crtp<T>, public Transaction, public TransactionArgs, pu
         }
 
         if (loc_info.is_local) {
+            auto span = WorkerContext::get().trace.scope(stats::Trace::local_lock, table->id);
             WorkerContext::get().cycl.start(stats::Cycles::local_latency);
             auto future = mempool.allocate<Future_t>();
             future->tuple = nullptr;
             if (!table->get(key, AccessMode::WRITE, future, ts)) [[unlikely]] {
+                WorkerContext::get().aborts.set_cause(stats::Aborts::local, table->id, key, AccessMode::WRITE);
                 return nullptr;
             }
             if constexpr (CC_SCHEME != CC_Scheme::NONE) {
-                log.add_write(table, key, future);
+                log.add_write(table, key);
             }
             if (!future->get()) [[unlikely]] {
+                WorkerContext::get().aborts.set_cause(stats::Aborts::local, table->id, key, AccessMode::WRITE);
                 return nullptr;
             }
             WorkerContext::get().cycl.stop(stats::Cycles::local_latency);
@@ -196,6 +237,8 @@ struct TransactionBase : crtp<T>, public Transaction, public TransactionArgs, pu
         }
 
         WorkerContext::get().cycl.start(stats::Cycles::remote_latency);
+        auto span = WorkerContext::get().trace.scope(stats::Trace::remote_access, loc_info.target);
+        db.msg_handler->putresponses.wait_row(tid, table->id, key);
         auto pkt = db.comm->make_pkt();
         auto req = pkt->ctor<msg::TupleGetReq>(ts, table->id, key, mode);
         req->sender = db.comm->node_id;
@@ -204,13 +247,82 @@ struct TransactionBase : crtp<T>, public Transaction, public TransactionArgs, pu
         auto msg_id = db.msg_handler->set_new_id(req);
         db.msg_handler->add_future(msg_id, future);
 
+        const msg::TupleGetReq sent = *req; // for resends
         db.comm->send(loc_info.target, pkt, tid);
-        if constexpr (CC_SCHEME != CC_Scheme::NONE) {
-            log.add_remote_write(future, loc_info.target);
+        if (msg_timeout.count() > 0) {
+            await_remote(future, loc_info.target, sent, sizeof(sent));
         }
         if (!future->get()) [[unlikely]] {
+            WorkerContext::get().aborts.set_cause(stats::Aborts::remote, table->id, key, AccessMode::WRITE);
+            return nullptr;
+        }
+        if constexpr (CC_SCHEME != CC_Scheme::NONE) {
+            log.add_remote_write(future->get_pkt(), loc_info.target, sizeof(Tuple_t));
+        }
+        WorkerContext::get().cycl.stop(stats::Cycles::remote_latency);
+        return future;
+    }
+
+    // Runs Fragment (see db/fragment.hpp) on the tuple under a lock of
+    // Fragment::MODE. With --ship_fragments a remote tuple stays at its owner:
+    // one TupleCallReq locks it and runs the fragment there, only args and
+    // result cross the network. The lock is held until commit like for
+    // write(), autocommit releases it right after the fragment instead, for
+    // the last access of a txn. Local and switch-managed tuples are fetched.
+    // Returns nullptr if the lock failed, get() of the future is nullptr if
+    // the fragment refused.
+    template <typename Fragment>
+    CallFuture<typename Fragment::Result>* call(Table_t<typename Fragment::Tuple_t>* table, p4db::key_t key,
+                                                const typename Fragment::Args& args, bool autocommit = false) {
+        using Future_t = CallFuture<typename Fragment::Result>;
+        constexpr AccessMode mode = Fragment::MODE;
+
+        auto loc_info = table->part_info.location(key);
+
+        if (loc_info.is_local || !ship_fragments || (LM_ON_SWITCH && loc_info.is_hot)) {
+            auto tuple_f = (Fragment::MODE == AccessMode::WRITE) ? write(table, key) : read(table, key);
+            if (!tuple_f) [[unlikely]] {
+                return nullptr;
+            }
+            auto future = mempool.allocate<Future_t>();
+            if (Fragment::apply(*tuple_f->get(), args, future->local)) [[likely]] {
+                future->result = &future->local;
+            } else {
+                future->refused = true;
+                future->fail();
+            }
+            return future;
+        }
+
+        WorkerContext::get().cycl.start(stats::Cycles::remote_latency);
+        auto span = WorkerContext::get().trace.scope(stats::Trace::remote_access, loc_info.target);
+        db.msg_handler->putresponses.wait_row(tid, table->id, key);
+        auto pkt = db.comm->make_pkt();
+        auto req = pkt->ctor<msg::TupleCallReq>(ts, table->id, key, mode, Fragment::ID, autocommit);
+        constexpr auto size = msg::TupleCallReq::size(sizeof(args));
+        pkt->resize(size);
+        std::memcpy(req->args, &args, sizeof(args));
+        req->sender = db.comm->node_id;
+
+        auto future = mempool.allocate<Future_t>();
+        auto msg_id = db.msg_handler->set_new_id(req);
+        db.msg_handler->add_future(msg_id, future);
+
+        alignas(msg::TupleCallReq) uint8_t sent[size]; // for resends
+        std::memcpy(sent, req, size);
+        db.comm->send(loc_info.target, pkt, tid);
+        if (msg_timeout.count() > 0) {
+            await_remote(future, loc_info.target, *reinterpret_cast<const msg::TupleCallReq*>(sent), size);
+        }
+        if (!future->get() && !future->refused) [[unlikely]] {
+            WorkerContext::get().aborts.set_cause(stats::Aborts::remote, table->id, key, mode);
             return nullptr;
         }
+        if constexpr (CC_SCHEME != CC_Scheme::NONE) {
+            if (!future->refused) { // refused calls hold no lock, the pkt is freed already
+                log.add_remote_call(future->get_pkt(), loc_info.target);
+            }
+        }
         WorkerContext::get().cycl.stop(stats::Cycles::remote_latency);
         return future;
     }
@@ -227,7 +339,7 @@ struct TransactionBase : crtp<T>, public Transaction, public TransactionArgs, pu
             return nullptr;
         }
         if constexpr (CC_SCHEME != CC_Scheme::NONE) {
-            log.add_write(table, key, future);
+            log.add_write(table, key);
         }
         if (!future->get()) [[unlikely]] {
             return nullptr;
@@ -237,6 +349,48 @@ struct TransactionBase : crtp<T>, public Transaction, public TransactionArgs, pu
     }
 
 
+    // Resends the lock request (size bytes of req) whenever msg_timeout passes
+    // without a reply, the owner answers duplicates from its ReplyCache. After
+    // msg_retries resends the request is cancelled and the future fails, so
+    // the access aborts. An autocommit call is never cancelled, the owner may
+    // have applied and committed it already: like a put it is resent until the
+    // reply tells whether it was applied.
+    template <typename Future_t, typename Req_t>
+    void await_remote(Future_t* future, msg::node_t target, const Req_t& req, std::size_t size) {
+        bool cancellable = true;
+        if constexpr (std::is_same_v<Req_t, msg::TupleCallReq>) {
+            cancellable = !req.autocommit;
+        }
+        for (uint32_t attempt = 0;; ++attempt) {
+            if (future->wait_until(std::chrono::steady_clock::now() + msg_timeout)) [[likely]] {
+                return;
+            }
+            if (attempt >= msg_retries && cancellable) {
+                break;
+            }
+            auto pkt = db.comm->make_pkt();
+            pkt->resize(size);
+            std::memcpy(pkt->as<uint8_t>(), &req, size);
+            db.comm->send(target, pkt, tid);
+            WorkerContext::get().cntr.incr(stats::Counter::msg_retransmits);
+        }
+
+        AbstractFuture* open = nullptr;
+        try {
+            open = db.msg_handler->open_futures.erase(req.msg_id);
+        } catch (...) {
+        }
+        if (!open) { // the reply won the race and is being delivered
+            return;
+        }
+        future->fail();
+        if constexpr (CC_SCHEME != CC_Scheme::NONE) {
+            db.msg_handler->cancel(target, req.msg_id, req, tid);
+        }
+        WorkerContext::get().cntr.incr(stats::Counter::msg_timeouts);
+    }
+
+
     template <typename P4Switch, typename Arg_t>
     auto atomic(P4Switch& p4_switch, const Arg_t& arg) {
         auto& comm = db.comm;
@@ -252,15 +406,17 @@ struct TransactionBase : crtp<T>, public Transaction, public TransactionArgs, pu
         pkt->resize(size);
 
         auto parse_fn = [&](Communicator::Pkt_t* pkt) {
+            WorkerContext::get().trace.end(stats::Trace::switch_txn);
             auto txn = pkt->as<msg::SwitchTxn>();
             BufferReader br{txn->data};
             return p4_switch.parse_txn(arg, br);
         };
         using Future_t = SwitchFuture<decltype(parse_fn)>;
 
-        auto future = mempool.allocate<Future_t>(std::move(parse_fn));
+        auto future = mempool.allocate<Future_t>(std::move(parse_fn), msg_timeout * (msg_retries + 1));
         auto msg_id = comm->handler->set_new_id(txn);
         comm->handler->add_future(msg_id, future);
+        WorkerContext::get().trace.begin(stats::Trace::switch_txn);
         comm->send(comm->switch_id, pkt, tid);
 
         return future;
@@ -268,6 +424,15 @@ struct TransactionBase : crtp<T>, public Transaction, public TransactionArgs, pu
 };
 
 
+template <typename Arg_t>
+struct TxnNames;
+
+template <typename... Ts>
+struct TxnNames<std::variant<Ts...>> {
+    static constexpr std::array<std::string_view, sizeof...(Ts)> value{Ts::TXN_NAME...};
+};
+
+
 struct TxnExecutorStats { // TODO merge with counters?
     uint64_t commits = 0;
     uint64_t rollbacks = 0;
@@ -275,6 +440,10 @@ struct TxnExecutorStats { // TODO merge with counters?
     int64_t duration = 0;
     uint64_t on_switch = 0;
 
+    // latency in ns per txn type, measured from scheduled arrival in open-loop mode
+    std::vector<std::string_view> txn_names;
+    std::vector<stats::Histogram> latencies;
+
     template <typename T>
     static auto accumulate(T& container) {
         TxnExecutorStats stats;
@@ -284,6 +453,14 @@ struct TxnExecutorStats { // TODO merge with counters?
             stats.num_txns += s.num_txns;
             stats.duration += s.duration;
             stats.on_switch += s.on_switch;
+
+            if (stats.latencies.size() < s.latencies.size()) {
+                stats.txn_names = s.txn_names;
+                stats.latencies.resize(s.latencies.size());
+            }
+            for (size_t i = 0; auto& hist : s.latencies) {
+                stats.latencies[i++].merge(hist);
+            }
         }
         if (container.size() > 0) {
             stats.duration /= container.size();
@@ -291,14 +468,12 @@ struct TxnExecutorStats { // TODO merge with counters?
         return stats;
     }
 
-    template <typename T>
-    void count_on_switch(T& txns) {
-        on_switch = std::count_if(txns.begin(), txns.end(), [](auto& txn) {
-            return std::visit([](auto& txn) {
-                return txn.on_switch;
-            },
-                              txn);
-        });
+    template <typename Arg_t>
+    void count_on_switch(const Arg_t& arg) {
+        on_switch += std::visit([](const auto& txn) -> uint64_t {
+            return txn.on_switch;
+        },
+                                arg);
     }
 
     friend std::ostream& operator<<(std::ostream& os, const TxnExecutorStats& self) {
@@ -315,23 +490,57 @@ struct TxnExecutorStats { // TODO merge with counters?
         ss << "total_on_switch=" << self.on_switch << '\n';
         ss << "avg_duration=" << self.duration << " µs\n";
 
+        for (size_t i = 0; auto& hist : self.latencies) {
+            auto& name = self.txn_names[i++];
+            if (hist.count() == 0) {
+                continue;
+            }
+            ss << name << "_txns=" << hist.count() << '\n';
+            for (auto [suffix, p] : {std::pair{"p50", 0.5}, {"p90", 0.9}, {"p99", 0.99}, {"p999", 0.999}}) {
+                ss << name << '_' << suffix << '=' << hist.percentile(p) / 1e3 << " µs\n";
+            }
+        }
+
         os << ss.str();
         return os;
     }
 };
 
 
-template <typename Transaction_t, typename Arg_t>
-auto txn_executor(Database& db, std::vector<Arg_t> txns) {
+template <typename Transaction_t, typename Generator_t>
+auto txn_executor(Database& db, Generator_t& txns) {
+
+    using clock = ArrivalProcess::clock;
+    using Arg_t = typename Transaction_t::Arg_t;
+    auto& config = Config::instance();
 
     TxnExecutorStats stats;
+    constexpr auto& names = TxnNames<Arg_t>::value;
+    stats.txn_names.assign(names.begin(), names.end());
+    stats.latencies.resize(names.size());
+    if constexpr (ENABLED_STATS & StatsBitmask::CYCLES) {
+        stats::StatsCollector::get().set_txn_names(stats.txn_names);
+    }
 
     Transaction_t txn{db};
 
+    const bool open_loop = config.arrival_rate > 0;
+    ArrivalProcess arrivals{config.arrival, config.arrival_rate, (config.node_id << 16 | WorkerContext::get().tid) ^ 0x9e3779b97f4a7c15};
+
     auto start = std::chrono::high_resolution_clock::now();
+    txns.start();
+    arrivals.start(clock::now());
+
+    while (auto arg = txns.next()) {
+        auto arrival = open_loop ? arrivals.next() : clock::now();
+        if (open_loop) {
+            ArrivalProcess::wait_until(arrival);
+        }
+
+        auto rc = txn.execute(*arg);
 
-    for (auto& arg : txns) {
-        auto rc = txn.execute(arg);
+        auto latency = std::chrono::duration_cast<std::chrono::nanoseconds>(clock::now() - arrival).count();
+        stats.latencies[arg->index()].add(latency);
 
         // std::stringstream ss;
         // ss << "Finished txn tid=" << txn.tid << " ts=" << txn.ts << " rc=" << rc << '\n';
@@ -346,12 +555,14 @@ auto txn_executor(Database& db, std::vector<Arg_t> txns) {
                 ++stats.rollbacks;
                 break;
         }
+        stats.count_on_switch(*arg);
     }
+    db.msg_handler->putresponses.wait(WorkerContext::get().tid); // last releases of async_commit
 
     auto end = std::chrono::high_resolution_clock::now();
 
     stats.duration = std::chrono::duration_cast<std::chrono::microseconds>(end - start).count();
-    stats.num_txns = txns.size();
+    stats.num_txns = txns.generated();
 
     auto tps = (stats.num_txns > 0) ? static_cast<uint64_t>(stats.num_txns / (stats.duration / 1e6)) : 0;
     std::stringstream ss;
@@ -361,4 +572,4 @@ auto txn_executor(Database& db, std::vector<Arg_t> txns) {
 
 
     return stats;
-}
\ No newline at end of file
+}
@@ -2,7 +2,11 @@
 
 #include "types.hpp"
 
+#include <algorithm>
+#include <atomic>
 #include <chrono>
+#include <cpuid.h>
+#include <ctime>
 #include <iostream>
 #include <sstream>
 
@@ -46,6 +50,118 @@ struct UniqueClockTimestampFactory {
 };
 
 
+// ns since the unix epoch from rdtsc, calibrated once per process against
+// CLOCK_REALTIME, so that timestamps of different nodes agree up to their
+// clock skew. Without an invariant TSC it falls back to clock_gettime.
+class TscClock {
+    __extension__ using uint128_t = unsigned __int128;
+
+    uint64_t tsc0 = 0;
+    uint64_t ns0 = 0;
+    uint64_t mult = 0; // ns per tick << 32, 0 if the TSC is not usable
+
+public:
+    static const TscClock& get() {
+        static const TscClock clock;
+        return clock;
+    }
+
+    uint64_t now_ns() const {
+        if (!mult) [[unlikely]] {
+            return realtime_ns();
+        }
+        uint64_t ticks = __builtin_ia32_rdtsc() - tsc0;
+        return ns0 + static_cast<uint64_t>((static_cast<uint128_t>(ticks) * mult) >> 32);
+    }
+
+private:
+    TscClock() {
+        uint32_t eax, ebx, ecx, edx;
+        if (!__get_cpuid(0x80000007, &eax, &ebx, &ecx, &edx) || !(edx & (1u << 8))) {
+            std::cerr << "TSC is not invariant, timestamps use clock_gettime\n";
+            return;
+        }
+        using clock = std::chrono::steady_clock;
+        const auto start = clock::now();
+        const uint64_t start_tsc = __builtin_ia32_rdtsc();
+        while (clock::now() - start < std::chrono::milliseconds(20)) {
+            __builtin_ia32_pause();
+        }
+        const auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(clock::now() - start).count();
+        const uint64_t ticks = __builtin_ia32_rdtsc() - start_tsc;
+
+        mult = (static_cast<uint128_t>(ns) << 32) / ticks;
+        ns0 = realtime_ns();
+        tsc0 = __builtin_ia32_rdtsc();
+    }
+
+    static uint64_t realtime_ns() {
+        timespec now;
+        clock_gettime(CLOCK_REALTIME, &now);
+        return static_cast<uint64_t>(now.tv_sec) * 1'000'000'000 + now.tv_nsec;
+    }
+};
+
+// Wall clock ns from TscClock above node and tid bits like
+// UniqueClockTimestampFactory, but without a syscall per txn and strictly
+// increasing per worker. The ns wrap every 3.26 days, which timestamp_t
+// comparisons tolerate.
+struct TscTimestampFactory {
+    static constexpr uint64_t TICK = 1 << 16;
+
+    const TscClock& clock = TscClock::get();
+    uint64_t mask;
+    uint64_t last;
+
+    TscTimestampFactory() {
+        auto& config = Config::instance();
+        mask = (config.node_id << 8) | WorkerContext::get().tid;
+        last = (clock.now_ns() << 16) - TICK;
+    }
+
+    timestamp_t get() {
+        uint64_t ts = clock.now_ns() << 16;
+        if (static_cast<int64_t>(ts - last) <= 0) [[unlikely]] { // same ns as before
+            ts = last + TICK;
+        }
+        last = ts;
+        return timestamp_t{ts | mask};
+    }
+};
+
+// Lamport clock, counts txns instead of time. Every lock request from another
+// node advances it past the requester's timestamp (see observe), so the txns of
+// a less busy node do not stay the oldest and win every conflict in WAIT_DIE.
+struct LogicalTimestampFactory {
+    static inline std::atomic<uint64_t> node_clock{0}; // highest clock seen on this node
+
+    uint64_t mask;
+    uint64_t clock = 0;
+
+    LogicalTimestampFactory() {
+        auto& config = Config::instance();
+        mask = (config.node_id << 8) | WorkerContext::get().tid;
+    }
+
+    timestamp_t get() {
+        clock = std::max(clock, node_clock.load(std::memory_order_relaxed)) + 1;
+        advance(clock);
+        return timestamp_t{(clock << 16) | mask};
+    }
+
+    static void observe(const timestamp_t ts) {
+        advance(ts >> 16);
+    }
+
+private:
+    static void advance(uint64_t clock) {
+        uint64_t seen = node_clock.load(std::memory_order_relaxed);
+        while (seen < clock && !node_clock.compare_exchange_weak(seen, clock, std::memory_order_relaxed)) {
+        }
+    }
+};
+
+
 struct AtomicTimestampFactory {
     static inline std::atomic<uint64_t> cntr{1};
 
@@ -58,4 +174,6 @@ struct AtomicTimestampFactory {
 
 // using TimestampFactory = AtomicTimestampFactory;
 // using TimestampFactory = ClockTimestampFactory;
-using TimestampFactory = UniqueClockTimestampFactory;
\ No newline at end of file
+// using TimestampFactory = UniqueClockTimestampFactory;
+// using TimestampFactory = LogicalTimestampFactory;
+using TimestampFactory = TscTimestampFactory;
\ No newline at end of file
@@ -0,0 +1,84 @@
+#pragma once
+
+#include "db/config.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+
+// Pulls transaction arguments from a generator function in small batches
+// instead of materializing all num_txns arguments upfront. Memory stays
+// constant and the run can be bounded by count and/or duration.
+template <typename Arg_t, typename Fn>
+class TxnGenerator {
+    using clock = std::chrono::steady_clock;
+
+public:
+    static constexpr std::size_t BATCH_SIZE = 64;
+
+    TxnGenerator(Fn fn, uint64_t num_txns, std::chrono::seconds duration)
+        : fn(std::move(fn)), num_txns(num_txns), duration(duration) {
+        batch.reserve(BATCH_SIZE);
+        refill(); // prefetch first batch before the measurement starts
+    }
+
+    // starts the duration timer, call right before executing the first txn
+    void start() {
+        if (duration.count() > 0) {
+            deadline = clock::now() + duration;
+        }
+    }
+
+    // returns nullptr if num_txns are generated or duration is exceeded
+    Arg_t* next() {
+        if (pos == batch.size()) [[unlikely]] {
+            if (!refill()) {
+                return nullptr;
+            }
+        }
+        return &batch[pos++];
+    }
+
+    uint64_t generated() const {
+        return num_generated;
+    }
+
+private:
+    bool refill() {
+        batch.clear();
+        pos = 0;
+        if (num_generated >= num_txns) {
+            return false;
+        }
+        if (clock::now() >= deadline) {
+            return false;
+        }
+
+        auto n = std::min<uint64_t>(BATCH_SIZE, num_txns - num_generated);
+        for (uint64_t i = 0; i < n; ++i) {
+            batch.emplace_back(fn());
+        }
+        num_generated += n;
+        return true;
+    }
+
+    Fn fn;
+    const uint64_t num_txns;
+    const std::chrono::seconds duration;
+    clock::time_point deadline = clock::time_point::max();
+
+    std::vector<Arg_t> batch;
+    std::size_t pos = 0;
+    uint64_t num_generated = 0;
+};
+
+
+template <typename Arg_t, typename Fn>
+auto make_txn_generator(Fn&& fn) {
+    auto& config = Config::instance();
+    return TxnGenerator<Arg_t, std::decay_t<Fn>>{std::forward<Fn>(fn), config.num_txns, std::chrono::seconds{config.duration_s}};
+}
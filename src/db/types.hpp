@@ -93,11 +93,27 @@ static_assert(std::is_trivial<key_t>::value, "key_t is not a POD");
 } // namespace p4db
 
 
+// Ordered like serial numbers (RFC 1982), a is older than b if b is less than
+// 2^63 ahead. Clock based timestamps may wrap around, this stays correct as
+// long as concurrent txns are not that far apart.
 struct timestamp_t {
     uint64_t value;
     operator uint64_t() const {
         return value;
     }
+
+    friend bool operator<(const timestamp_t a, const timestamp_t b) {
+        return static_cast<int64_t>(a.value - b.value) < 0;
+    }
+    friend bool operator>(const timestamp_t a, const timestamp_t b) {
+        return b < a;
+    }
+    friend bool operator<=(const timestamp_t a, const timestamp_t b) {
+        return !(b < a);
+    }
+    friend bool operator>=(const timestamp_t a, const timestamp_t b) {
+        return !(a < b);
+    }
 };
 
 
@@ -123,6 +139,52 @@ inline std::istream& operator>>(std::istream& is, BenchmarkType& type) {
     }
     return is;
 }
+inline std::ostream& operator<<(std::ostream& os, const BenchmarkType& type) {
+    switch (type) {
+        case BenchmarkType::YCSB:
+            os << "ycsb";
+            break;
+        case BenchmarkType::SMALLBANK:
+            os << "smallbank";
+            break;
+        case BenchmarkType::TPCC:
+            os << "tpcc";
+            break;
+        case BenchmarkType::MICRO_RECIRC:
+            os << "micro_recirc";
+            break;
+    }
+    return os;
+}
+
+
+enum class ArrivalType {
+    CONSTANT,
+    POISSON,
+};
+inline std::istream& operator>>(std::istream& is, ArrivalType& type) {
+    std::string s;
+    is >> s;
+    if (s == "constant") {
+        type = ArrivalType::CONSTANT;
+    } else if (s == "poisson") {
+        type = ArrivalType::POISSON;
+    } else {
+        throw std::invalid_argument("Could not parse ArrivalType.");
+    }
+    return is;
+}
+inline std::ostream& operator<<(std::ostream& os, const ArrivalType& type) {
+    switch (type) {
+        case ArrivalType::CONSTANT:
+            os << "constant";
+            break;
+        case ArrivalType::POISSON:
+            os << "poisson";
+            break;
+    }
+    return os;
+}
 
 
 enum class CC_Scheme {
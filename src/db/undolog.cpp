@@ -1,29 +1,105 @@
 #include "undolog.hpp"
 
 #include "comm/msg_handler.hpp"
+#include "table/table.hpp"
 
 
 /* Private methods */
 
-void Undolog::clear(const timestamp_t ts) {
-    for (auto& action : actions) {
-        action->clear(comm, tid, ts);
+void Undolog::release(Entry& e, const timestamp_t ts, bool commit) {
+    switch (e.kind) {
+        case Kind::LOCAL_READ:
+            if (!e.table->put_fn(e.table, e.key, AccessMode::READ, ts)) {
+                throw error::UndoException();
+            }
+            return;
+        case Kind::LOCAL_WRITE:
+            if (!e.table->put_fn(e.table, e.key, AccessMode::WRITE, ts)) {
+                throw error::UndoException();
+            }
+            return;
+        case Kind::REMOTE_READ:
+        case Kind::REMOTE_WRITE: {
+            auto pkt = e.pkt;
+            auto req = pkt->as<msg::TupleGetRes>()->convert<msg::TuplePutReq>();
+            req->sender = msg::node_t{comm->node_id, tid};
+
+            std::size_t size;
+            if (e.kind == Kind::REMOTE_READ) {
+                size = msg::TuplePutReq::size(0);
+                pkt->resize(size);
+            } else {
+                // the txn wrote the tuple in place, where it was received in
+                // res->tuple, which is req->tuple now: nothing to copy
+                size = msg::TuplePutReq::size(e.tuple_size);
+            }
+            comm->handler->putresponses.add(tid, e.target, pkt, size);
+            comm->send(e.target, pkt, tid);
+            return;
+        }
+        case Kind::REMOTE_CALL: {
+            auto pkt = e.pkt;
+            auto res = pkt->as<msg::TupleCallRes>();
+            if (res->autocommit) { // released by the owner right away
+                pkt->free();
+                return;
+            }
+            const msg::TupleMsgHeader held = *res;
+            const auto msg_id = res->msg_id;
+            auto req = pkt->ctor<msg::TupleReleaseReq>(held.ts, held.tid, held.rid, held.mode, commit);
+            req->sender = msg::node_t{comm->node_id, tid};
+            req->msg_id = msg_id;
+            comm->handler->putresponses.add(tid, e.target, pkt, sizeof(msg::TupleReleaseReq));
+            comm->send(e.target, pkt, tid);
+            return;
+        }
+    }
+}
+
+
+void Undolog::clear(const timestamp_t ts, bool commit) {
+    auto span = WorkerContext::get().trace.scope(stats::Trace::undo_clear);
+    auto& puts = comm->handler->putresponses;
+    if (puts.async) {
+        puts.make_room(tid, size);
     }
-    pool.clear();
-    actions.clear();
+    {
+        const TxBatch batch{comm, tid}; // remote puts and lock grants go out as bursts
+        for (std::size_t i = 0; i < size; ++i) {
+            release(at(i), ts, commit);
+        }
+    }
+    size = 0;
+    overflow.clear();
+    if (puts.async) {
+        return; // acknowledged in the background, see TuplePutResHandler::wait_row
+    }
+    auto wait_span = WorkerContext::get().trace.scope(stats::Trace::put_res_wait);
     comm->handler->putresponses.wait(tid); // wait for all remote responses
 }
 
 
-void Undolog::clear_last_n(const timestamp_t ts, const size_t n) {
-    if (actions.size() < n) {
+void Undolog::clear_last_n(const timestamp_t ts, const size_t n, bool commit) {
+    if (size < n) {
         throw std::runtime_error("tried clearing more in undolog than that is there...");
     }
-    for (size_t i = 0; i < n; i++) {
-        auto action = actions.back();
-        action->clear(comm, tid, ts);
-        actions.pop_back();
+    auto& puts = comm->handler->putresponses;
+    if (puts.async) {
+        puts.make_room(tid, n);
+    }
+    {
+        const TxBatch batch{comm, tid};
+        for (size_t i = 0; i < n; i++) {
+            release(at(size - 1), ts, commit);
+            if (--size >= CAPACITY) {
+                overflow.pop_back();
+            }
+        }
     }
     // putresponses += 1 on remote.clear()
+    if (puts.async) {
+        return;
+    }
+    auto wait_span = WorkerContext::get().trace.scope(stats::Trace::put_res_wait);
     comm->handler->putresponses.wait(tid); // wait for all remote responses
-}
\ No newline at end of file
+}
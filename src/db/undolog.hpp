@@ -2,150 +2,122 @@
 
 #include "comm/comm.hpp"
 #include "comm/msg_handler.hpp"
-#include "db/future.hpp"
-#include "db/mempools.hpp"
+#include "db/errors.hpp"
 #include "stats/context.hpp"
 
+#include <array>
+#include <cstdint>
+#include <vector>
 
-struct Action {
-    virtual ~Action() = default;
-    virtual void clear(Communicator* comm, uint32_t tid, const timestamp_t ts) = 0;
-};
-
-template <typename Table_t, typename Future_t>
-struct Write final : public Action {
-    Table_t* table;
-    p4db::key_t index;
-    Future_t* future;
-
-    Write(Table_t* table, p4db::key_t index, Future_t* future)
-        : table(table), index(index), future(future) {}
-
-    void clear(Communicator*, uint32_t, const timestamp_t ts) override {
-        if (!future->tuple) {
-            throw std::runtime_error("tuple not set in undolog clear");
-        }
-        if (!table->put(index, AccessMode::WRITE, ts)) {
-            throw error::UndoException();
-        }
-    }
-};
-
-template <typename Table_t, typename Future_t>
-struct Read final : public Action {
-    Table_t* table;
-    p4db::key_t index;
-    Future_t* future;
 
-    Read(Table_t* table, p4db::key_t index, Future_t* future)
-        : table(table), index(index), future(future) {}
-
-    void clear(Communicator*, uint32_t, const timestamp_t ts) override {
-        if (!future->tuple) {
-            throw std::runtime_error("tuple not set in undolog clear");
-        }
-        if (!table->put(index, AccessMode::READ, ts)) {
-            throw error::UndoException();
-        }
-    }
-};
-
-template <typename Tuple_t, AccessMode mode>
-struct Remote final : public Action {
-    TupleFuture<Tuple_t>* future;
-    msg::node_t target;
-
-    Remote(TupleFuture<Tuple_t>* future, msg::node_t target)
-        : future(future), target(target) {}
-
-    void clear(Communicator* comm, uint32_t tid, const timestamp_t) override {
-        auto tuple = future->get();
-        if (!tuple) {
-            return; // TupleGetReq Failed, but action is in Log, pkt is already freed earlier
-        }
-
-        auto pkt = future->get_pkt();
-        auto res = pkt->template as<msg::TupleGetRes>();
-
-        auto req = res->template convert<msg::TuplePutReq>();
-        if (req->tid > 4) {
-            std::cout << "tid=" << req->tid << " mode=" << static_cast<int>(res->mode) << " msg_id=" << res->msg_id << " tid=" << res->tid << '\n';
-            throw std::runtime_error("sth wrong");
-        }
-        req->sender = msg::node_t{comm->node_id, tid};
-
-        switch (mode) {
-            case AccessMode::READ: {
-                auto size = msg::TuplePutReq::size(0);
-                pkt->resize(size);
-                break;
-            }
-            case AccessMode::WRITE: {
-                // size is already enough because we received the tuple of same size
-                std::memcpy(req->tuple, tuple, sizeof(Tuple_t));
-                break;
-            }
-            default:
-                throw error::InvalidAccessMode();
-        }
-
-        comm->handler->putresponses.add(tid);
-        comm->send(target, pkt, tid);
-    }
-};
+struct Table;
 
 
+// Locks held by the running txn, released on commit or rollback. The log is a
+// flat array of plain entries dispatched by a switch on their kind: local rows
+// are unlocked through Table::put_fn, remote ones with the TupleGetRes or
+// TupleCallRes that granted them, which becomes the release message.
 struct Undolog {
-    StackPool<65536> pool;
-    std::vector<Action*> actions; // maybe embed into struct
+    enum class Kind : uint8_t {
+        LOCAL_READ,
+        LOCAL_WRITE,
+        REMOTE_READ,
+        REMOTE_WRITE, // the tuple goes back with the put
+        REMOTE_CALL,  // lock kept by a shipped fragment, the owner holds the undo state
+    };
+
+    struct Entry {
+        Kind kind;
+        msg::node_t target;  // remote
+        uint32_t tuple_size; // REMOTE_WRITE
+        union {
+            Table* table;              // local
+            Communicator::Pkt_t* pkt;  // remote, the reply that granted the lock
+        };
+        p4db::key_t key; // local
+    };
+    static_assert(sizeof(Entry) == 24);
+
+    static constexpr std::size_t CAPACITY = 256; // entries without touching the heap
+
     Communicator* comm;
     uint32_t tid;
+    std::size_t size = 0;
+    std::array<Entry, CAPACITY> entries;
+    std::vector<Entry> overflow; // keeps its capacity, for txns with more than CAPACITY locks
 
     Undolog(Communicator* comm)
         : comm(comm), tid(WorkerContext::get().tid) {}
 
-    template <typename Table_t, typename Future_t>
-    void add_write(Table_t* table, p4db::key_t index, Future_t* future) {
-        auto action = pool.allocate<Write<Table_t, Future_t>>(table, index, future);
-        actions.emplace_back(action);
+    void add_read(Table* table, p4db::key_t index) {
+        Entry& e = push(Kind::LOCAL_READ);
+        e.table = table;
+        e.key = index;
     }
 
-    template <typename Table_t, typename Future_t>
-    void add_read(Table_t* table, p4db::key_t index, Future_t* future) {
-        auto action = pool.allocate<Read<Table_t, Future_t>>(table, index, future);
-        actions.emplace_back(action);
+    void add_write(Table* table, p4db::key_t index) {
+        Entry& e = push(Kind::LOCAL_WRITE);
+        e.table = table;
+        e.key = index;
     }
 
-    template <typename Tuple_t>
-    void add_remote_read(TupleFuture<Tuple_t>* future, msg::node_t target) {
-        auto action = pool.allocate<Remote<Tuple_t, AccessMode::READ>>(future, target);
-        actions.emplace_back(action);
+    // after the lock was granted, pkt holds the TupleGetRes
+    void add_remote_read(Communicator::Pkt_t* pkt, msg::node_t target) {
+        Entry& e = push(Kind::REMOTE_READ);
+        e.target = target;
+        e.pkt = pkt;
     }
 
-    template <typename Tuple_t>
-    void add_remote_write(TupleFuture<Tuple_t>* future, msg::node_t target) {
-        auto action = pool.allocate<Remote<Tuple_t, AccessMode::WRITE>>(future, target);
-        actions.emplace_back(action);
+    void add_remote_write(Communicator::Pkt_t* pkt, msg::node_t target, uint32_t tuple_size) {
+        Entry& e = push(Kind::REMOTE_WRITE);
+        e.target = target;
+        e.tuple_size = tuple_size;
+        e.pkt = pkt;
+    }
+
+    // after the fragment was applied, pkt holds the TupleCallRes
+    void add_remote_call(Communicator::Pkt_t* pkt, msg::node_t target) {
+        Entry& e = push(Kind::REMOTE_CALL);
+        e.target = target;
+        e.pkt = pkt;
     }
 
     void commit(const timestamp_t ts) {
-        clear(ts);
+        clear(ts, true);
     }
 
     void rollback(const timestamp_t ts) {
-        clear(ts);
+        clear(ts, false);
     }
 
     void commit_last_n(const timestamp_t ts, const size_t n) {
-        clear_last_n(ts, n);
+        clear_last_n(ts, n, true);
     }
 
     void rollback_last_n(const timestamp_t ts, const size_t n) {
-        clear_last_n(ts, n);
+        clear_last_n(ts, n, false);
     }
 
 private:
-    void clear(const timestamp_t ts);
+    Entry& push(Kind kind) {
+        Entry* e;
+        if (size < CAPACITY) [[likely]] {
+            e = &entries[size];
+        } else {
+            e = &overflow.emplace_back();
+        }
+        ++size;
+        e->kind = kind;
+        return *e;
+    }
+
+    Entry& at(std::size_t i) {
+        return (i < CAPACITY) ? entries[i] : overflow[i - CAPACITY];
+    }
+
+    void release(Entry& e, const timestamp_t ts, bool commit);
 
-    void clear_last_n(const timestamp_t ts, const size_t n);
-};
\ No newline at end of file
+    void clear(const timestamp_t ts, bool commit);
+
+    void clear_last_n(const timestamp_t ts, const size_t n, bool commit);
+};
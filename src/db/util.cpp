@@ -1,5 +1,6 @@
 #include "util.hpp"
 
+#include "db/config.hpp"
 #include "stats/context.hpp"
 
 #include <numeric>
@@ -8,6 +9,9 @@
 void pin_worker(uint32_t core, pthread_t pid /*= pthread_self()*/) {
     WorkerContext::get().tid = core;
     core += 2; // make space for dpdk main and receiver thread
+    if (auto& config = Config::instance(); config.local_cluster) {
+        core += config.node_id * (config.num_txn_workers + 3); // nodes share the host: 2 reserved, workers, handler
+    }
 
     constexpr auto NUM_SOCKETS = 2;
     constexpr auto NUM_HYPERTHREADS = 2;
@@ -35,6 +39,11 @@ void pin_worker(uint32_t core, pthread_t pid /*= pthread_self()*/) {
         if constexpr (SINGLE_NUMA) {
             map.resize(map.size() / 2);
         }
+        if (map.empty()) { // fewer cores than the assumed topology, e.g. CI
+            for (unsigned i = 0; i < threads; ++i) {
+                map.emplace_back(i);
+            }
+        }
 
         std::stringstream ss;
         ss << "CPU MAP:\n";
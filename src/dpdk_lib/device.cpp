@@ -223,6 +223,17 @@ bool DpdkDevice::configurePort(uint8_t numOfRxQueues, uint8_t numOfTxQueues) {
     portConf.rx_adv_conf.rss_conf.rss_key_len = m_Config.rssKeyLength;
     portConf.rx_adv_conf.rss_conf.rss_hf = convertRssHfToDpdkRssHf(m_Config.rssHashFunction);
 
+    // chained mbufs, used to attach tuples without copying them, only on request
+    m_MultiSegTx = false;
+    if (m_Config.multiSegTx) {
+        rte_eth_dev_info devInfo;
+        rte_eth_dev_info_get(m_Id, &devInfo);
+        m_MultiSegTx = (devInfo.tx_offload_capa & DEV_TX_OFFLOAD_MULTI_SEGS) != 0;
+        if (m_MultiSegTx) {
+            portConf.txmode.offloads |= DEV_TX_OFFLOAD_MULTI_SEGS;
+        }
+    }
+
     int res = rte_eth_dev_configure((uint8_t)m_Id, numOfRxQueues, numOfTxQueues, &portConf);
     if (res < 0) {
         LOG_ERROR("Failed to configure device [%s]. error is: '%s' [Error code: %d]\n", m_DeviceName, rte_strerror(res), res);
@@ -510,6 +521,24 @@ void DpdkDevice::getStatistics(DpdkDeviceStats& stats) const {
     memcpy(&m_PrevStats, &stats, sizeof(m_PrevStats));
 }
 
+void DpdkDevice::getExtendedStatistics(std::vector<std::pair<std::string, uint64_t>>& xstats) const {
+    xstats.clear();
+    int num = rte_eth_xstats_get_names(m_Id, nullptr, 0);
+    if (num <= 0) {
+        return;
+    }
+    std::vector<struct rte_eth_xstat_name> names(num);
+    std::vector<struct rte_eth_xstat> values(num);
+    if (rte_eth_xstats_get_names(m_Id, names.data(), num) != num || rte_eth_xstats_get(m_Id, values.data(), num) != num) {
+        LOG_ERROR("Couldn't get xstats for device %d", m_Id);
+        return;
+    }
+    xstats.reserve(num);
+    for (auto& value : values) {
+        xstats.emplace_back(names[value.id].name, value.value);
+    }
+}
+
 void DpdkDevice::clearStatistics() {
     rte_eth_stats_reset(m_Id);
     memset(&m_PrevStats, 0, sizeof(m_PrevStats));
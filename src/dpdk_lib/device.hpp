@@ -9,6 +9,8 @@
 #include <iostream>
 #include <sstream>
 #include <string>
+#include <utility>
+#include <vector>
 #if (RTE_VER_YEAR > 17) || (RTE_VER_YEAR == 17 && RTE_VER_MONTH >= 11)
 #include "rte_bus_pci.h"
 #endif
@@ -205,6 +207,12 @@ public:
          */
         uint64_t rssHashFunction;
 
+        /**
+         * Enable sending mbufs chained from several segments (DEV_TX_OFFLOAD_MULTI_SEGS) if the PMD supports it.
+         * Off by default, as requesting the offload makes vector Tx PMDs fall back to their scalar Tx path
+         */
+        bool multiSegTx;
+
         /**
          * A c'tor for this struct
          * @param[in] receiveDescriptorsNumber An optional parameter for defining the number of RX descriptors that will be allocated for each RX queue.
@@ -227,6 +235,7 @@ public:
             this->rssKey = rssKey;
             this->rssKeyLength = rssKeyLength;
             this->rssHashFunction = rssHashFunction;
+            this->multiSegTx = false;
         }
     };
 
@@ -318,6 +327,11 @@ public:
      */
     DpdkPMDType getPMDType() const { return m_PMDType; }
 
+    /**
+     * @return True if DpdkDeviceConfiguration#multiSegTx was set and the device transmits mbufs chained from several segments
+     */
+    bool supportsMultiSegTx() const { return m_MultiSegTx; }
+
     /**
      * @return The PCI address of the device
      */
@@ -503,6 +517,12 @@ public:
          */
     void getStatistics(DpdkDeviceStats& stats) const;
 
+    /**
+         * Retrieve extended (driver specific) statistics from device
+         * @param[out] xstats Name/value pairs, e.g. rx_missed_errors or tx_q1_packets
+         */
+    void getExtendedStatistics(std::vector<std::pair<std::string, uint64_t>>& xstats) const;
+
     /**
          * Clear device statistics
          */
@@ -588,6 +608,7 @@ private:
     int m_Id;
     MacAddress m_MacAddress;
     uint16_t m_DeviceMtu;
+    bool m_MultiSegTx = false;
 
     struct rte_mempool* m_MBufMempool;
 
@@ -58,6 +58,32 @@ uint16_t DPDKPacket::size() {
     return rte_pktmbuf_pkt_len(this);
 }
 
+uint16_t DPDKPacket::head_size() {
+    return rte_pktmbuf_data_len(this);
+}
+
+
+// Attached memory is never freed by dpdk, the initial reference is never dropped.
+static void attached_free_cb(void*, void*) {}
+
+static rte_mbuf_ext_shared_info attached_shinfo = [] {
+    rte_mbuf_ext_shared_info shinfo{};
+    shinfo.free_cb = attached_free_cb;
+    rte_mbuf_ext_refcnt_set(&shinfo, 1);
+    return shinfo;
+}();
+
+void DPDKPacket::attach(DPDKPacket* seg, void* buf, rte_iova_t iova, uint16_t len) {
+    rte_mbuf_ext_refcnt_update(&attached_shinfo, 1);
+    rte_pktmbuf_attach_extbuf(seg, buf, iova, len, &attached_shinfo);
+    seg->data_len = len;
+    seg->pkt_len = len;
+    if (unlikely(rte_pktmbuf_chain(this, seg) != 0)) {
+        rte_pktmbuf_free(seg);
+        throw std::invalid_argument("too many segments to attach to mbuf");
+    }
+}
+
 void DPDKPacket::free() {
     rte_pktmbuf_free(this);
 }
@@ -45,6 +45,14 @@ struct DPDKPacket : private rte_mbuf {
 
     uint16_t size();
 
+    // bytes in the first segment
+    uint16_t head_size();
+
+    // Chains seg to the end of this packet, seg points to len bytes of memory
+    // the NIC reads directly. The memory is not owned and must stay valid and
+    // unchanged until the packet was sent.
+    void attach(DPDKPacket* seg, void* buf, rte_iova_t iova, uint16_t len);
+
     void free();
 };
 static_assert(sizeof(DPDKPacket) == sizeof(struct rte_mbuf));
@@ -1,5 +1,6 @@
 #include "benchmarks/benchmarks.hpp"
 #include "db/config.hpp"
+#include "stats/toggle.hpp"
 
 
 // #define USE_VTUNE
@@ -16,11 +17,8 @@ __itt_resume();
 #endif // USE_VTUNE
 
 
-int main(int argc, char** argv) {
+static int run_workload() {
     auto& config = Config::instance();
-    config.parse_cli(argc, argv);
-    config.print();
-
     switch (config.workload) {
         case BenchmarkType::YCSB: {
             using namespace benchmark::ycsb;
@@ -39,4 +37,22 @@ int main(int argc, char** argv) {
             return micro_recirc();
         }
     }
+    return EXIT_FAILURE;
+}
+
+
+int main(int argc, char** argv) {
+    auto& config = Config::instance();
+    config.parse_cli(argc, argv);
+    config.print();
+
+    stats::Toggle::set(config.stats);
+    stats::Toggle::install_signal_handler();
+
+#ifdef P4DB_COMM_SHM
+    if (config.local_cluster) {
+        return ShmCommunicator::fork_nodes(run_workload);
+    }
+#endif
+    return run_workload();
 }
\ No newline at end of file
@@ -0,0 +1,128 @@
+#include "harness.hpp"
+
+#include "datastructures/linked_list.hpp"
+#include "datastructures/stupid_hashmap.hpp"
+#include "db/mempools.hpp"
+
+
+namespace microbench {
+
+namespace {
+
+// insert() + erase() of a thread-private key, arg = number of buckets the
+// threads spread over. A bucket holds NUM_SLOTS entries, so at least
+// threads / NUM_SLOTS buckets are used to not overflow one.
+struct StupidHashMapBench : Benchmark {
+    static constexpr std::size_t N = 1024;
+    using Map_t = StupidHashMap<uint64_t, uint64_t*, N>;
+    static constexpr auto NUM_SLOTS = Map_t::Bucket::NUM_SLOTS;
+
+    std::unique_ptr<Map_t> map;
+    uint64_t buckets;
+
+    bool supported(const Params& params) override {
+        return params.arg <= N && params.threads <= N * NUM_SLOTS;
+    }
+
+    void setup(const Params& params) override {
+        buckets = std::max<uint64_t>(params.arg, (params.threads + NUM_SLOTS - 1) / NUM_SLOTS);
+        map = std::make_unique<Map_t>();
+    }
+
+    void run(State& state) override {
+        uint64_t value;
+        while (state.keep_running()) {
+            // keys are unique per thread, bucket = key % N
+            const uint64_t key = (state.rand() % buckets) + N * state.tid;
+            map->insert(key, &value);
+            map->erase(key);
+        }
+    }
+};
+MICROBENCH(StupidHashMapBench, "buckets", {1, 64, 1024});
+
+
+// allocate() a burst of arg nodes, then deallocate() them. Bursts beyond
+// CACHE_SIZE miss the thread-local cache and go to the shared free list.
+struct FixedThreadsafeMempoolBench : Benchmark {
+    struct Node {
+        uint64_t data[8];
+    };
+    using Pool_t = FixedThreadsafeMempool<Node>;
+
+    std::unique_ptr<Pool_t> pool;
+
+    void setup(const Params& params) override {
+        // each thread holds at most its burst plus two caches worth of nodes
+        pool = std::make_unique<Pool_t>(params.threads * (params.arg + 2 * CACHE_SIZE + 1));
+    }
+
+    void run(State& state) override {
+        std::vector<Node*> burst(state.params.arg);
+        while (state.keep_running()) {
+            for (auto& node : burst) {
+                node = pool->allocate();
+            }
+            for (auto node : burst) {
+                pool->deallocate(node);
+            }
+        }
+    }
+};
+MICROBENCH(FixedThreadsafeMempoolBench, "burst", {1, 64, 256});
+
+
+// add_sorted() into a thread-private list of arg entries, then remove one
+// again, like the owner/waiter lists of WAIT_DIE rows.
+struct LinkedListBench : Benchmark {
+    struct Entry {
+        uint64_t ts;
+        bool operator<(const Entry& other) {
+            return ts < other.ts;
+        }
+    };
+    using List_t = LinkedList<Entry>;
+
+    void run(State& state) override {
+        List_t list;
+        for (uint64_t i = 0; i < state.params.arg; ++i) {
+            list.add_sorted(Entry{state.rand()});
+        }
+        while (state.keep_running()) {
+            const uint64_t ts = state.rand();
+            list.add_sorted(Entry{ts});
+            list.remove_if_one([&](const auto& entry) {
+                return entry.ts == ts;
+            });
+        }
+        list.remove_until([](const auto&) {
+            return true;
+        });
+    }
+};
+MICROBENCH(LinkedListBench, "length", {0, 8, 64, 4096});
+
+
+// arg allocations of a 64 byte object, then clear(), as done per txn. More
+// than 1023 objects need further Arena blocks.
+struct ArenaBench : Benchmark {
+    struct Object {
+        uint64_t data[8];
+    };
+
+    void run(State& state) override {
+        auto pool = std::make_unique<Arena>();
+        while (state.keep_running()) {
+            for (uint64_t i = 0; i < state.params.arg; ++i) {
+                auto obj = pool->allocate<Object>();
+                asm volatile("" : : "r"(obj) : "memory");
+            }
+            pool->clear();
+        }
+    }
+};
+MICROBENCH(ArenaBench, "objects", {1, 16, 256, 4096});
+
+} // namespace
+
+} // namespace microbench
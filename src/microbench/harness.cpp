@@ -0,0 +1,188 @@
+#include "harness.hpp"
+
+#include "db/util.hpp"
+#include "stats/context.hpp"
+
+#include <barrier>
+#include <chrono>
+#include <ctime>
+#include <iomanip>
+#include <regex>
+#include <sstream>
+#include <thread>
+#include <unistd.h>
+
+
+namespace microbench {
+
+namespace {
+
+double thread_cpu_ns() {
+    timespec ts;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+Result run_once(const Registration& reg, const Options& options, const Params& params) {
+    auto bench = reg.create();
+    bench->setup(params);
+
+    std::atomic<bool> stop{false};
+    std::barrier sync{params.threads + 1};
+    std::vector<uint64_t> iterations(params.threads);
+    std::vector<double> cpu_ns(params.threads);
+
+    std::vector<std::thread> workers;
+    for (uint32_t tid = 0; tid < params.threads; ++tid) {
+        workers.emplace_back([&, tid]() {
+            WorkerContext::guard worker_ctx;
+            if (options.pin) {
+                pin_worker(tid); // also sets the tid
+            } else {
+                WorkerContext::get().tid = tid;
+            }
+            State state{tid, params, stop};
+
+            sync.arrive_and_wait();
+            auto cpu_start = thread_cpu_ns();
+            bench->run(state);
+            cpu_ns[tid] = thread_cpu_ns() - cpu_start;
+            iterations[tid] = state.iterations;
+        });
+    }
+
+    sync.arrive_and_wait();
+    auto start = std::chrono::steady_clock::now();
+    std::this_thread::sleep_for(std::chrono::duration<double>(options.min_time_s));
+    stop.store(true, std::memory_order_relaxed);
+    for (auto& w : workers) {
+        w.join();
+    }
+    auto elapsed_ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+    bench->teardown();
+
+    Result result;
+    result.name = reg.name + '/' + reg.arg_name + ':' + std::to_string(params.arg) + "/threads:" + std::to_string(params.threads);
+    result.threads = params.threads;
+    result.iterations = 0;
+    double cpu_sum = 0;
+    for (uint32_t tid = 0; tid < params.threads; ++tid) {
+        result.iterations += iterations[tid];
+        cpu_sum += cpu_ns[tid];
+    }
+    const double its = std::max<uint64_t>(result.iterations, 1);
+    result.real_time_ns = elapsed_ns * params.threads / its;
+    result.cpu_time_ns = cpu_sum / its;
+    result.items_per_second = result.iterations / (elapsed_ns / 1e9);
+    return result;
+}
+
+void write_escaped(std::ostream& os, const std::string& s) {
+    os << '"';
+    for (char c : s) {
+        if (c == '"' || c == '\\') {
+            os << '\\';
+        }
+        os << c;
+    }
+    os << '"';
+}
+
+} // namespace
+
+
+std::vector<Registration>& Registry::get() {
+    static std::vector<Registration> registrations;
+    return registrations;
+}
+
+
+std::vector<Result> run_all(const Options& options) {
+    const std::regex filter{options.filter.empty() ? ".*" : options.filter};
+
+    std::stringstream header;
+    header << std::left << std::setw(48) << "Benchmark" << std::right << std::setw(15) << "Time" << std::setw(15) << "CPU"
+           << std::setw(14) << "Iterations" << std::setw(16) << "Items\n";
+    std::cout << header.str();
+
+    std::vector<Result> results;
+    for (auto& reg : Registry::get()) {
+        if (!std::regex_search(reg.name, filter)) {
+            continue;
+        }
+        auto& args = options.args.empty() ? reg.default_args : options.args;
+        for (auto arg : args) {
+            for (auto threads : options.threads) {
+                Params params{threads, arg};
+                {
+                    auto probe = reg.create();
+                    if (!probe->supported(params)) {
+                        std::cerr << "skipping " << reg.name << '/' << reg.arg_name << ':' << arg << "/threads:" << threads << '\n';
+                        continue;
+                    }
+                }
+                for (uint32_t rep = 0; rep < options.repetitions; ++rep) {
+                    auto& result = results.emplace_back(run_once(reg, options, params));
+                    print_console(std::cout, result);
+                }
+            }
+        }
+    }
+    return results;
+}
+
+
+void print_console(std::ostream& os, const Result& result) {
+    std::stringstream ss;
+    ss << std::left << std::setw(48) << result.name << std::right << std::fixed << std::setprecision(1)
+       << std::setw(12) << result.real_time_ns << " ns"
+       << std::setw(12) << result.cpu_time_ns << " ns"
+       << std::setw(14) << result.iterations
+       << std::setprecision(3) << std::setw(12) << result.items_per_second / 1e6 << " M/s\n";
+    os << ss.str();
+}
+
+
+void write_json(std::ostream& os, const std::vector<Result>& results) {
+    char host[256] = {};
+    gethostname(host, sizeof(host) - 1);
+    auto now = std::time(nullptr);
+    char date[64];
+    std::strftime(date, sizeof(date), "%FT%T%z", std::localtime(&now));
+
+    os << "{\n";
+    os << "  \"context\": {\n";
+    os << "    \"date\": \"" << date << "\",\n";
+    os << "    \"host_name\": ";
+    write_escaped(os, host);
+    os << ",\n";
+    os << "    \"num_cpus\": " << std::thread::hardware_concurrency() << ",\n";
+#ifdef NDEBUG
+    os << "    \"library_build_type\": \"release\"\n";
+#else
+    os << "    \"library_build_type\": \"debug\"\n";
+#endif
+    os << "  },\n";
+    os << "  \"benchmarks\": [";
+    for (size_t i = 0; auto& r : results) {
+        os << (i++ ? ",\n" : "\n");
+        os << "    {\n";
+        os << "      \"name\": ";
+        write_escaped(os, r.name);
+        os << ",\n";
+        os << "      \"run_name\": ";
+        write_escaped(os, r.name);
+        os << ",\n";
+        os << "      \"run_type\": \"iteration\",\n";
+        os << "      \"threads\": " << r.threads << ",\n";
+        os << "      \"iterations\": " << r.iterations << ",\n";
+        os << "      \"real_time\": " << r.real_time_ns << ",\n";
+        os << "      \"cpu_time\": " << r.cpu_time_ns << ",\n";
+        os << "      \"time_unit\": \"ns\",\n";
+        os << "      \"items_per_second\": " << r.items_per_second << '\n';
+        os << "    }";
+    }
+    os << "\n  ]\n}\n";
+}
+
+} // namespace microbench
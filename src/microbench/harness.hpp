@@ -0,0 +1,116 @@
+#pragma once
+
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <vector>
+
+
+namespace microbench {
+
+// Parameters of one run, the same for all threads.
+struct Params {
+    uint32_t threads;
+    uint64_t arg; // contention knob, meaning depends on the benchmark (see arg_name)
+};
+
+
+// Handed to every benchmark thread, loop with while (state.keep_running()).
+struct State {
+    const uint32_t tid;
+    const Params& params;
+    uint64_t iterations = 0;
+
+    State(uint32_t tid, const Params& params, const std::atomic<bool>& stop)
+        : tid(tid), params(params), stop(stop) {}
+
+    bool keep_running() {
+        if (stop.load(std::memory_order_relaxed)) [[unlikely]] {
+            return false;
+        }
+        ++iterations;
+        return true;
+    }
+
+    uint64_t rand() { // xorshift, cheap enough to not dominate the measured op
+        seed ^= seed << 13;
+        seed ^= seed >> 7;
+        seed ^= seed << 17;
+        return seed;
+    }
+
+private:
+    const std::atomic<bool>& stop;
+    uint64_t seed = 0x9e3779b97f4a7c15 * (tid + 1);
+};
+
+
+// A benchmark owns the shared objects, setup()/teardown() are called once per
+// run from the main thread, run() concurrently by every benchmark thread.
+struct Benchmark {
+    virtual ~Benchmark() = default;
+
+    virtual void setup(const Params&) {}
+    virtual void run(State& state) = 0;
+    virtual void teardown() {}
+
+    // runs that cannot be executed, e.g. a fixed size pool is too small
+    virtual bool supported(const Params&) {
+        return true;
+    }
+};
+
+
+struct Registration {
+    std::string name;
+    std::string arg_name;
+    std::vector<uint64_t> default_args;
+    std::unique_ptr<Benchmark> (*create)();
+};
+
+struct Registry {
+    static std::vector<Registration>& get();
+
+    template <typename Benchmark_t>
+    static int add(std::string name, std::string arg_name, std::vector<uint64_t> default_args) {
+        get().push_back(Registration{std::move(name), std::move(arg_name), std::move(default_args), []() -> std::unique_ptr<Benchmark> {
+                                         return std::make_unique<Benchmark_t>();
+                                     }});
+        return 0;
+    }
+};
+
+#define MICROBENCH(Benchmark_t, arg_name, ...) \
+    static int __microbench_##Benchmark_t = ::microbench::Registry::add<Benchmark_t>(#Benchmark_t, arg_name, __VA_ARGS__)
+
+
+struct Result {
+    std::string name;
+    uint32_t threads;
+    uint64_t iterations;   // sum over all threads
+    double real_time_ns;   // wall time per iteration and thread
+    double cpu_time_ns;    // cpu time per iteration, summed over threads
+    double items_per_second;
+};
+
+
+struct Options {
+    std::vector<uint32_t> threads;
+    std::vector<uint64_t> args; // empty = per benchmark defaults
+    std::string filter;         // regex on the benchmark name
+    double min_time_s = 0.5;
+    uint32_t repetitions = 1;
+    bool pin = true;
+};
+
+
+std::vector<Result> run_all(const Options& options);
+
+// console table and google-benchmark compatible json (compare.py works on it)
+void print_console(std::ostream& os, const Result& result);
+void write_json(std::ostream& os, const std::vector<Result>& results);
+
+} // namespace microbench
@@ -0,0 +1,119 @@
+#include "harness.hpp"
+
+#include "comm/comm.hpp"
+#include "db/config.hpp"
+#include "db/spinlock.hpp"
+#include "table/concurrency_control/no_wait.hpp"
+#include "table/concurrency_control/wait_die.hpp"
+
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <sys/mman.h>
+#include <unistd.h>
+
+
+// arg = number of shared locks/rows the threads pick from uniformly,
+// 1 = every thread hammers the same one.
+
+namespace microbench {
+
+namespace {
+
+struct alignas(64) PaddedSpinLock {
+    SpinLock lock;
+    uint64_t value = 0;
+};
+
+struct SpinLockBench : Benchmark {
+    std::unique_ptr<PaddedSpinLock[]> locks;
+    uint64_t num_locks;
+
+    void setup(const Params& params) override {
+        num_locks = params.arg;
+        locks = std::make_unique<PaddedSpinLock[]>(num_locks);
+    }
+
+    void run(State& state) override {
+        while (state.keep_running()) {
+            auto& l = locks[state.rand() % num_locks];
+            const std::lock_guard<SpinLock> guard(l.lock);
+            ++l.value;
+        }
+    }
+};
+MICROBENCH(SpinLockBench, "locks", {1, 16, 1024});
+
+
+struct Tuple {
+    uint64_t value;
+};
+
+
+#ifdef P4DB_COMM_SHM
+// Row locks as taken by local transactions: local_lock() directly followed
+// by local_unlock(), half reads and half writes. Rows are laid out like in
+// StructTable, i.e. unpadded.
+// local_unlock() takes the communicator to grant remote waiters, there are
+// none here. Only the shm transport can be set up in-process, on a region of
+// its own; the other transports need a configured cluster.
+template <CC_Scheme scheme>
+struct RowLockBench : Benchmark {
+    using Row_t = Row<Tuple, scheme>;
+    std::unique_ptr<Row_t[]> rows;
+    uint64_t num_rows;
+
+    std::unique_ptr<Communicator> comm;
+
+    inline static std::atomic<uint64_t> next_ts{1};
+
+    void setup(const Params& params) override {
+        auto& config = Config::instance();
+        config.num_nodes = 1;
+        config.set_node_id(0);
+        config.num_txn_workers = params.threads;
+        config.shm_name = "/p4db_microbench_" + std::to_string(getpid());
+        comm = std::make_unique<Communicator>();
+
+        num_rows = params.arg;
+        rows = std::make_unique<Row_t[]>(num_rows);
+    }
+
+    void run(State& state) override {
+        while (state.keep_running()) {
+            auto& row = rows[state.rand() % num_rows];
+            const AccessMode mode = (state.rand() & 1) ? AccessMode::WRITE : AccessMode::READ;
+            const timestamp_t ts{next_ts.fetch_add(1, std::memory_order_relaxed)};
+
+            TupleFuture<Tuple> future;
+            if (row.local_lock(mode, ts, &future) != ErrorCode::SUCCESS) {
+                continue; // lock conflict, counts as (aborted) iteration
+            }
+            while (!future.tuple.load(std::memory_order_acquire)) { // WAIT_DIE: granted by the owner's unlock
+                __builtin_ia32_pause();
+            }
+            auto rc = row.local_unlock(mode, ts, *comm);
+            (void)rc;
+        }
+    }
+
+    void teardown() override {
+        comm.reset();
+        shm_unlink(Config::instance().shm_name.c_str());
+        for (uint64_t i = 0; i < num_rows; ++i) {
+            if (!rows[i].check()) {
+                throw std::runtime_error("row still locked after benchmark");
+            }
+        }
+    }
+};
+
+using RowNoWaitBench = RowLockBench<CC_Scheme::NO_WAIT>;
+using RowWaitDieBench = RowLockBench<CC_Scheme::WAIT_DIE>;
+MICROBENCH(RowNoWaitBench, "rows", {1, 16, 1024});
+MICROBENCH(RowWaitDieBench, "rows", {1, 16, 1024});
+#endif
+
+} // namespace
+
+} // namespace microbench
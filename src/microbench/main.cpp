@@ -0,0 +1,70 @@
+#include "db/config.hpp"
+#include "harness.hpp"
+#include "stats/collector.hpp"
+#include "stats/toggle.hpp"
+
+#include <cxxopts.hpp>
+#include <fstream>
+#include <thread>
+
+
+int main(int argc, char** argv) {
+    cxxopts::Options options("p4db_microbench", "Microbenchmarks for P4DB locks and data structures");
+
+    // clang-format off
+    options.add_options()
+        ("threads", "Thread counts to run, default 1,2,4,.. up to the number of cores", cxxopts::value<std::vector<uint32_t>>())
+        ("arg", "Contention knob (locks, rows, buckets, ..), overrides the per benchmark defaults", cxxopts::value<std::vector<uint64_t>>())
+        ("filter", "Only run benchmarks matching this regex", cxxopts::value<std::string>()->default_value(""))
+        ("min_time", "Seconds per run", cxxopts::value<double>()->default_value("0.5"))
+        ("repetitions", "", cxxopts::value<uint32_t>()->default_value("1"))
+        ("no_pin", "Do not pin threads to cores")
+        ("json", "Write results in google-benchmark json format to this file", cxxopts::value<std::string>())
+        ("list", "List benchmarks and exit")
+        ("h,help", "Print usage")
+    ;
+    // clang-format on
+
+    auto result = options.parse(argc, argv);
+    if (result.count("help")) {
+        std::cout << options.help() << '\n';
+        return 0;
+    }
+    if (result.count("list")) {
+        for (auto& reg : microbench::Registry::get()) {
+            std::cout << reg.name << " (" << reg.arg_name << ")\n";
+        }
+        return 0;
+    }
+
+    microbench::Options opts;
+    if (result.count("threads")) {
+        opts.threads = result["threads"].as<std::vector<uint32_t>>();
+    } else {
+        const uint32_t max_threads = std::max(1u, std::thread::hardware_concurrency());
+        for (uint32_t t = 1; t < max_threads; t *= 2) {
+            opts.threads.emplace_back(t);
+        }
+        opts.threads.emplace_back(max_threads);
+    }
+    if (result.count("arg")) {
+        opts.args = result["arg"].as<std::vector<uint64_t>>();
+    }
+    opts.filter = result["filter"].as<std::string>();
+    opts.min_time_s = result["min_time"].as<double>();
+    opts.repetitions = result["repetitions"].as<uint32_t>();
+    opts.pin = !result.count("no_pin");
+
+    // measure the primitives, not the stats around them, and leave no csv files behind
+    Config::instance().stats = StatsBitmask::NONE;
+    stats::Toggle::set(StatsBitmask::NONE);
+    stats::StatsCollector::disabled = true;
+
+    auto results = microbench::run_all(opts);
+
+    if (result.count("json")) {
+        std::ofstream json{result["json"].as<std::string>()};
+        microbench::write_json(json, results);
+    }
+    return 0;
+}
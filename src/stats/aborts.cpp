@@ -0,0 +1,80 @@
+#include "aborts.hpp"
+
+#include "collector.hpp"
+#include "db/config.hpp"
+#include "stats/context.hpp"
+
+#include <atomic>
+#include <sstream>
+
+namespace stats {
+
+Aborts::Aborts() {
+    if constexpr (!(ENABLED_STATS & StatsBitmask::ABORTS)) {
+        return;
+    }
+    sample_rate = Config::instance().abort_sample_rate;
+    if (sample_rate > 0) {
+        ring.reserve(RING_SIZE);
+    }
+    StatsCollector::get().reg(this);
+}
+
+
+Aborts::~Aborts() {
+    if constexpr (!(ENABLED_STATS & StatsBitmask::ABORTS)) {
+        return;
+    }
+    StatsCollector::get().dereg(this);
+}
+
+
+void Aborts::record_slow(const std::source_location& loc) {
+    Record rec;
+    if (has_pending) {
+        rec = pending;
+        has_pending = false;
+    }
+    rec.line = loc.line();
+    rec.file = loc.file_name();
+    rec.function = loc.function_name();
+
+    std::atomic_ref{origins[rec.origin]}.store(origins[rec.origin] + 1, std::memory_order_relaxed); // read by metrics
+
+    if (rec.origin != user) {
+        auto it = keys.find(KeyId{rec.table, rec.key});
+        if (it == keys.end() && keys.size() < MAX_TRACKED_KEYS) {
+            it = keys.try_emplace(KeyId{rec.table, rec.key}).first;
+        }
+        if (it != keys.end()) {
+            ++it->second.origins[rec.origin];
+            it->second.writes += (rec.mode == AccessMode::WRITE);
+        } else {
+            ++untracked_keys;
+        }
+    }
+
+    auto& site = sites[CallSite{rec.file, rec.line}];
+    site.function = rec.function;
+    ++site.count;
+
+    if (sample_rate > 0 && (num_aborts % sample_rate) == 0) {
+        if (ring.size() < RING_SIZE) {
+            ring.push_back(rec);
+        } else {
+            ring[ring_pos] = rec;
+        }
+        ring_pos = (ring_pos + 1) % RING_SIZE;
+    }
+    ++num_aborts;
+
+    if constexpr (error::PRINT_ABORT_CAUSE) {
+        std::stringstream ss;
+        ss << "abort tid=" << WorkerContext::get().tid << " origin=" << enum2str[rec.origin]
+           << " table=" << rec.table << " key=" << rec.key << " mode=" << rec.mode
+           << " at " << rec.file << ':' << rec.line << '\n';
+        std::cout << ss.str();
+    }
+}
+
+} // namespace stats
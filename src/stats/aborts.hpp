@@ -0,0 +1,146 @@
+#pragma once
+
+
+#include "db/defs.hpp"
+#include "db/util.hpp"
+
+#include <array>
+#include <cstdint>
+#include <functional>
+#include <source_location>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+
+namespace stats {
+
+// Attributes every rollback to the access that caused it. A failing
+// read/write sets a pending cause, the following rollback() consumes it
+// together with its call site. Rollbacks without pending cause are
+// application aborts (e.g. insufficient balance).
+struct Aborts {
+    Aborts();
+    ~Aborts();
+
+    enum Origin : uint8_t {
+        local,
+        remote,
+        on_switch,
+        user,
+        __MAX
+    };
+
+    static constexpr std::array<std::string_view, __MAX> enum2str{
+        "local",
+        "remote",
+        "switch",
+        "user",
+    };
+
+    static constexpr std::size_t MAX_TRACKED_KEYS = 65536; // further keys only counted as untracked
+    static constexpr std::size_t RING_SIZE = 4096;
+    static constexpr std::size_t TOP_N = 20;
+
+    struct Record {
+        uint64_t table = 0;
+        uint64_t key = 0;
+        uint32_t mode = 0; // AccessMode::value_t
+        Origin origin = user;
+        uint32_t line = 0;
+        const char* file = "";
+        const char* function = "";
+    };
+
+    struct KeyId {
+        uint64_t table;
+        uint64_t key;
+        bool operator==(const KeyId&) const = default;
+    };
+    struct KeyIdHash {
+        std::size_t operator()(const KeyId& k) const {
+            return std::hash<uint64_t>{}(k.key * 0x9e3779b97f4a7c15 ^ k.table);
+        }
+    };
+    struct KeyStats {
+        std::array<uint64_t, __MAX> origins{};
+        uint64_t writes = 0;
+
+        uint64_t total() const {
+            uint64_t sum = 0;
+            for (auto& o : origins) {
+                sum += o;
+            }
+            return sum;
+        }
+    };
+
+    struct CallSite {
+        const char* file;
+        uint32_t line;
+        bool operator==(const CallSite&) const = default;
+    };
+    struct CallSiteHash {
+        std::size_t operator()(const CallSite& s) const {
+            return std::hash<const void*>{}(s.file) ^ s.line;
+        }
+    };
+    struct SiteStats {
+        const char* function = "";
+        uint64_t count = 0;
+    };
+
+    std::array<uint64_t, __MAX> origins{};
+    uint64_t untracked_keys = 0;
+    std::unordered_map<KeyId, KeyStats, KeyIdHash> keys;
+    std::unordered_map<CallSite, SiteStats, CallSiteHash> sites;
+
+    std::vector<Record> ring; // sampled records, allocated if abort_sample_rate > 0
+    std::size_t ring_pos = 0;
+    uint64_t sample_rate = 0;
+    uint64_t num_aborts = 0;
+
+    Record pending;
+    bool has_pending = false;
+    bool enabled = false; // runtime switch, see stats::Toggle
+
+
+#define __forceinline inline __attribute__((always_inline))
+
+    __forceinline void set_cause(const Origin origin [[maybe_unused]], const uint64_t table [[maybe_unused]],
+                                 const uint64_t key [[maybe_unused]], const uint32_t mode [[maybe_unused]]) {
+        if constexpr (!(ENABLED_STATS & StatsBitmask::ABORTS)) {
+            return;
+        }
+        if (!enabled) {
+            return;
+        }
+        pending.origin = origin;
+        pending.table = table;
+        pending.key = key;
+        pending.mode = mode;
+        has_pending = true;
+    }
+
+    __forceinline void clear_cause() {
+        if constexpr (!(ENABLED_STATS & StatsBitmask::ABORTS)) {
+            return;
+        }
+        has_pending = false;
+    }
+
+    __forceinline void record(const std::source_location& loc [[maybe_unused]]) {
+        if constexpr (!(ENABLED_STATS & StatsBitmask::ABORTS)) {
+            return;
+        }
+        if (!enabled) {
+            return;
+        }
+        record_slow(loc);
+    }
+
+private:
+    void record_slow(const std::source_location& loc);
+};
+
+} // namespace stats
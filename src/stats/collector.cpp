@@ -2,13 +2,25 @@
 
 #include "db/config.hpp"
 #include "scheduler.hpp"
+#include "stats/context.hpp"
 
+#include <algorithm>
 #include <fstream>
 
 
 namespace stats {
 
 StatsCollector::StatsCollector() {
+    if (disabled) {
+        return;
+    }
+    auto& config = Config::instance();
+    if (!config.metrics_socket.empty() || config.metrics_port > 0) {
+        metrics = std::make_unique<MetricsServer>(config.metrics_socket, config.metrics_port, [this](std::ostream& os) {
+            write_metrics(os);
+        });
+    }
+
     if constexpr (!(ENABLED_STATS & StatsBitmask::CYCLES || ENABLED_STATS & StatsBitmask::PERIODIC)) {
         return;
     }
@@ -51,18 +63,22 @@ StatsCollector::StatsCollector() {
         csv_periodic.open(PERIODIC_CSV_FILENAME);
         csv_periodic << "node_id,name,value,cc_scheme,use_switch\n";
         csv_periodic << std::boolalpha;
+        std::vector<Sample> samples;
 
         auto collect_periodic = [&]() {
             if constexpr (!(ENABLED_STATS & StatsBitmask::PERIODIC)) {
                 return;
             }
+            if (!(Toggle::get() & StatsBitmask::PERIODIC)) {
+                return;
+            }
 
             const std::lock_guard<std::mutex> lock(mutex);
             for (size_t i = 0; auto& name : Periodic::enum2str) {
                 auto& last = last_pcntrs[i];
                 uint64_t sum = 0;
                 for (auto& c : pcntrs) {
-                    sum += c->counters[i].load(std::memory_order_release);
+                    sum += c->counters[i].load(std::memory_order_relaxed);
                 }
                 if (sum > last) {
                     auto diff = sum - last;
@@ -73,11 +89,56 @@ StatsCollector::StatsCollector() {
                 }
                 ++i;
             }
+
+            last_samples.clear();
+            for (auto& [owner, sampler] : samplers) {
+                samples.clear();
+                sampler(samples);
+                for (auto& [name, value] : samples) {
+                    csv_periodic << node_id << ',' << name << ',' << value << ',' << CC_SCHEME << ',' << use_switch << '\n';
+                }
+                last_samples.insert(last_samples.end(), samples.begin(), samples.end());
+            }
         };
 
 
-        Scheduler<2> sched({{{collect_cycles, STATS_CYCLE_SAMPLE_TIME},
-                             {collect_periodic, STATS_PERIODIC_SAMPLE_TIME}}});
+        // percentiles of cycles per txn type within each periodic interval
+        std::ofstream csv_cycles_periodic;
+        auto last_hists = std::make_unique<Cycles::Histograms>();
+        auto curr_hists = std::make_unique<Cycles::Histograms>();
+        uint64_t interval = 0;
+        if constexpr (ENABLED_STATS & StatsBitmask::CYCLES) {
+            csv_cycles_periodic.open(CYCLES_PERIODIC_CSV_FILENAME);
+            csv_cycles_periodic << "node_id,interval,txn,name,count,p50,p90,p99,p999\n";
+        }
+
+        auto collect_hists = [&]() {
+            if constexpr (!(ENABLED_STATS & StatsBitmask::CYCLES)) {
+                return;
+            }
+
+            const std::lock_guard<std::mutex> lock(mutex);
+            for (auto& per_type : *curr_hists) {
+                for (auto& hist : per_type) {
+                    hist.clear();
+                }
+            }
+            merge_hists(*curr_hists);
+
+            auto diff = std::make_unique<Cycles::Histograms>(*curr_hists);
+            for (size_t i = 0; i < Cycles::MAX_TXN_TYPES; ++i) {
+                for (size_t j = 0; j < Cycles::__MAX; ++j) {
+                    (*diff)[i][j].subtract((*last_hists)[i][j]);
+                }
+            }
+            write_hists(csv_cycles_periodic, std::to_string(node_id) + ',' + std::to_string(interval++), *diff);
+            std::swap(curr_hists, last_hists);
+        };
+
+
+        Scheduler<3> sched({{{collect_cycles, STATS_CYCLE_SAMPLE_TIME},
+                             {collect_periodic, STATS_PERIODIC_SAMPLE_TIME},
+                             {collect_hists, STATS_PERIODIC_SAMPLE_TIME}}});
 
 
         while (!token.stop_requested()) {
@@ -88,7 +149,14 @@ StatsCollector::StatsCollector() {
 
 
 StatsCollector::~StatsCollector() {
-    if constexpr (ENABLED_STATS & StatsBitmask::COUNTER) {
+    if (disabled) {
+        return;
+    }
+    metrics.reset(); // stop serving before members go away
+
+    const auto configured = Toggle::get_configured(); // subset of ENABLED_STATS
+
+    if (configured & StatsBitmask::COUNTER) {
         std::stringstream ss;
         ss << "*** Counter Summary ***\n";
         for (size_t i = 0; auto& name : Counter::enum2str) {
@@ -97,13 +165,35 @@ StatsCollector::~StatsCollector() {
         std::cout << ss.str();
     }
 
-    if constexpr (ENABLED_STATS & StatsBitmask::CYCLES) {
+    if (configured & StatsBitmask::CYCLES) {
         std::stringstream ss;
         ss << "*** Cycles Summary ***\n";
         for (size_t i = 0; auto& name : Cycles::enum2str) {
             ss << name << '=' << avg_cycles.at(i++).avg() << '\n';
         }
         std::cout << ss.str();
+
+        auto& config = Config::instance();
+        auto total = std::make_unique<Cycles::Histograms>();
+        {
+            const std::lock_guard<std::mutex> lock(mutex);
+            merge_hists(*total);
+        }
+        std::ofstream csv_cycles{config.csv_file_cycles};
+        csv_cycles << "node_id,txn,name,count,p50,p90,p99,p999\n";
+        write_hists(csv_cycles, std::to_string(config.node_id), *total);
+    }
+
+    if (configured & StatsBitmask::ABORTS) {
+        print_aborts();
+    }
+
+    if constexpr (ENABLED_STATS & StatsBitmask::TRACE) {
+        write_trace();
+    }
+
+    if constexpr (ENABLED_STATS & StatsBitmask::PERF) {
+        print_perf();
     }
 }
 
@@ -146,6 +236,17 @@ void StatsCollector::dereg(Cycles* c) {
     cycles.erase(std::remove_if(cycles.begin(), cycles.end(), cmp),
                  cycles.end());
     // cycles.erase(std::remove(cycles.begin(), cycles.end(), c), cycles.end());
+
+    for (size_t i = 0; i < Cycles::MAX_TXN_TYPES; ++i) {
+        for (size_t j = 0; j < Cycles::__MAX; ++j) {
+            (*retired_hists)[i][j].merge((*c->hists)[i][j]);
+        }
+    }
+}
+
+void StatsCollector::set_txn_names(const std::vector<std::string_view>& names) {
+    const std::lock_guard<std::mutex> lock(mutex);
+    txn_names = names;
 }
 
 
@@ -159,4 +260,292 @@ void StatsCollector::dereg(Periodic* cntr) {
     pcntrs.erase(std::remove(pcntrs.begin(), pcntrs.end(), cntr), pcntrs.end());
 }
 
-} // namespace stats
\ No newline at end of file
+void StatsCollector::reg(const void* owner, Sampler sampler) {
+    const std::lock_guard<std::mutex> lock(mutex);
+    samplers.emplace_back(owner, std::move(sampler));
+}
+
+void StatsCollector::dereg(const void* owner) {
+    const std::lock_guard<std::mutex> lock(mutex);
+    samplers.erase(std::remove_if(samplers.begin(), samplers.end(), [&](auto& s) { return s.first == owner; }), samplers.end());
+}
+
+
+void StatsCollector::reg(Aborts* a) {
+    const std::lock_guard<std::mutex> lock(mutex);
+    abort_stats.push_back(a);
+}
+
+void StatsCollector::dereg(Aborts* a) {
+    const std::lock_guard<std::mutex> lock(mutex);
+    abort_stats.erase(std::remove(abort_stats.begin(), abort_stats.end(), a), abort_stats.end());
+
+    for (size_t i = 0; i < Aborts::__MAX; ++i) {
+        sum_aborts[i] += a->origins[i];
+    }
+    sum_untracked_keys += a->untracked_keys;
+    for (auto& [id, key_stats] : a->keys) {
+        auto& dest = abort_keys[id];
+        for (size_t i = 0; i < Aborts::__MAX; ++i) {
+            dest.origins[i] += key_stats.origins[i];
+        }
+        dest.writes += key_stats.writes;
+    }
+    for (auto& [site, site_stats] : a->sites) {
+        auto& dest = abort_sites[site];
+        dest.function = site_stats.function;
+        dest.count += site_stats.count;
+    }
+    auto tid = WorkerContext::get().tid;
+    for (auto& rec : a->ring) {
+        abort_samples.emplace_back(tid, rec);
+    }
+}
+
+void StatsCollector::set_table_name(uint64_t id, const std::string& name) {
+    const std::lock_guard<std::mutex> lock(mutex);
+    if (table_names.size() <= id) {
+        table_names.resize(id + 1);
+    }
+    table_names[id] = name;
+}
+
+void StatsCollector::reg(Trace*) {
+    const std::lock_guard<std::mutex> lock(mutex);
+    if (trace_start_tsc == 0) {
+        trace_start_time = std::chrono::steady_clock::now();
+        trace_start_tsc = __builtin_ia32_rdtsc();
+    }
+}
+
+void StatsCollector::dereg(Trace* t) {
+    const std::lock_guard<std::mutex> lock(mutex);
+    auto head = t->head.load(std::memory_order_acquire);
+    auto first = (head > Trace::RING_SIZE) ? head - Trace::RING_SIZE : 0;
+
+    auto& info = traces.emplace_back(TraceInfo{WorkerContext::get().tid, {}});
+    info.events.reserve(head - first);
+    for (auto i = first; i < head; ++i) {
+        info.events.push_back(t->ring[i & (Trace::RING_SIZE - 1)]);
+    }
+}
+
+void StatsCollector::dereg(Perf* p) {
+    const std::lock_guard<std::mutex> lock(mutex);
+    for (size_t i = 0; i < Perf::MAX_PHASES; ++i) {
+        for (size_t j = 0; j < Perf::__MAX; ++j) {
+            sum_perf[i][j] += p->sums[i][j];
+        }
+    }
+    sum_perf_commits += p->commits;
+}
+
+void StatsCollector::write_metrics(std::ostream& os) {
+    const std::lock_guard<std::mutex> lock(mutex);
+    auto& config = Config::instance();
+    const auto node = "node=\"" + std::to_string(config.node_id) + '"';
+    // workers write without atomics, values are read racy but untorn
+    auto load = [](auto& v) {
+        return std::atomic_ref{v}.load(std::memory_order_relaxed);
+    };
+
+    os << "# TYPE p4db_commits_total counter\n";
+    uint64_t commits = 0;
+    for (auto& c : pcntrs) {
+        commits += c->counters[Periodic::commits].load(std::memory_order_relaxed);
+    }
+    os << "p4db_commits_total{" << node << "} " << commits << '\n';
+
+    os << "# TYPE p4db_aborts_total counter\n";
+    for (size_t i = 0; auto& origin : Aborts::enum2str) {
+        uint64_t sum = sum_aborts[i];
+        for (auto& a : abort_stats) {
+            sum += load(a->origins[i]);
+        }
+        os << "p4db_aborts_total{" << node << ",origin=\"" << origin << "\"} " << sum << '\n';
+        ++i;
+    }
+
+    os << "# TYPE p4db_counter counter\n";
+    for (size_t i = 0; auto& name : Counter::enum2str) {
+        uint64_t sum = sum_counters[i];
+        for (auto& c : cntrs) {
+            sum += load(c->counters[i]);
+        }
+        os << "p4db_counter{" << node << ",name=\"" << name << "\"} " << sum << '\n';
+        ++i;
+    }
+
+    if constexpr (ENABLED_STATS & StatsBitmask::CYCLES) {
+        auto hists = std::make_unique<Cycles::Histograms>();
+        merge_hists(*hists);
+        os << "# TYPE p4db_cycles summary\n";
+        for (size_t i = 0; i < Cycles::MAX_TXN_TYPES; ++i) {
+            auto txn = (i < txn_names.size()) ? std::string{txn_names[i]} : std::to_string(i);
+            for (size_t j = 0; j < Cycles::__MAX; ++j) {
+                auto& hist = (*hists)[i][j];
+                auto count = hist.count();
+                if (count == 0) {
+                    continue;
+                }
+                auto labels = node + ",txn=\"" + txn + "\",phase=\"" + std::string{Cycles::enum2str[j]} + '"';
+                for (auto q : {0.5, 0.9, 0.99, 0.999}) {
+                    os << "p4db_cycles{" << labels << ",quantile=\"" << q << "\"} " << hist.percentile(q) << '\n';
+                }
+                os << "p4db_cycles_sum{" << labels << "} " << hist.sum() << '\n';
+                os << "p4db_cycles_count{" << labels << "} " << count << '\n';
+            }
+        }
+    }
+
+    os << "# TYPE p4db_sample gauge\n";
+    for (auto& [name, value] : last_samples) {
+        os << "p4db_sample{" << node << ",name=\"" << name << "\"} " << value << '\n';
+    }
+}
+
+
+// Private methods
+
+void StatsCollector::merge_hists(Cycles::Histograms& dest) {
+    for (size_t i = 0; i < Cycles::MAX_TXN_TYPES; ++i) {
+        for (size_t j = 0; j < Cycles::__MAX; ++j) {
+            dest[i][j].merge((*retired_hists)[i][j]);
+            for (auto& c_info : cycles) {
+                dest[i][j].merge((*c_info.cycles->hists)[i][j]);
+            }
+        }
+    }
+}
+
+void StatsCollector::write_hists(std::ostream& os, const std::string& prefix, const Cycles::Histograms& hists) {
+    for (size_t i = 0; i < Cycles::MAX_TXN_TYPES; ++i) {
+        auto txn = (i < txn_names.size()) ? std::string{txn_names[i]} : std::to_string(i);
+        for (size_t j = 0; j < Cycles::__MAX; ++j) {
+            auto& hist = hists[i][j];
+            auto count = hist.count();
+            if (count == 0) {
+                continue;
+            }
+            os << prefix << ',' << txn << ',' << Cycles::enum2str[j] << ',' << count << ','
+               << hist.percentile(0.5) << ',' << hist.percentile(0.9) << ','
+               << hist.percentile(0.99) << ',' << hist.percentile(0.999) << '\n';
+        }
+    }
+}
+
+void StatsCollector::print_aborts() {
+    const std::lock_guard<std::mutex> lock(mutex);
+    auto table_name = [&](uint64_t id) {
+        return (id < table_names.size() && !table_names[id].empty()) ? table_names[id] : std::to_string(id);
+    };
+
+    std::stringstream ss;
+    ss << "*** Abort Summary ***\n";
+    for (size_t i = 0; auto& name : Aborts::enum2str) {
+        ss << "aborts_" << name << '=' << sum_aborts[i++] << '\n';
+    }
+    ss << "aborts_untracked_keys=" << sum_untracked_keys << '\n';
+
+    std::vector<std::pair<Aborts::CallSite, Aborts::SiteStats>> sites{abort_sites.begin(), abort_sites.end()};
+    std::sort(sites.begin(), sites.end(), [](auto& lhs, auto& rhs) {
+        return lhs.second.count > rhs.second.count;
+    });
+    ss << "*** Top Abort Sites ***\n";
+    for (auto& [site, site_stats] : sites) {
+        ss << site.file << ':' << site.line << " (" << site_stats.function << ") aborts=" << site_stats.count << '\n';
+    }
+
+    std::vector<std::pair<Aborts::KeyId, Aborts::KeyStats>> keys;
+    keys.reserve(abort_keys.size());
+    for (auto& entry : abort_keys) {
+        keys.emplace_back(entry);
+    }
+    auto n = std::min(Aborts::TOP_N, keys.size());
+    std::partial_sort(keys.begin(), keys.begin() + n, keys.end(), [](auto& lhs, auto& rhs) {
+        return lhs.second.total() > rhs.second.total();
+    });
+    ss << "*** Top " << n << " Aborting Keys ***\n";
+    for (size_t i = 0; i < n; ++i) {
+        auto& [id, key_stats] = keys[i];
+        ss << "table=" << table_name(id.table) << " key=" << id.key << " aborts=" << key_stats.total();
+        for (size_t j = 0; j < Aborts::__MAX; ++j) {
+            if (key_stats.origins[j] > 0) {
+                ss << ' ' << Aborts::enum2str[j] << '=' << key_stats.origins[j];
+            }
+        }
+        ss << " writes=" << key_stats.writes << '\n';
+    }
+    std::cout << ss.str();
+
+    if (abort_samples.empty()) {
+        return;
+    }
+    auto node_id = Config::instance().node_id;
+    std::ofstream csv_aborts{ABORTS_CSV_FILENAME};
+    csv_aborts << "node_id,tid,origin,table,key,mode,file,line\n";
+    for (auto& [tid, rec] : abort_samples) {
+        csv_aborts << node_id << ',' << tid << ',' << Aborts::enum2str[rec.origin] << ',' << table_name(rec.table) << ','
+                   << rec.key << ',' << rec.mode << ',' << rec.file << ',' << rec.line << '\n';
+    }
+}
+
+void StatsCollector::write_trace() {
+    const std::lock_guard<std::mutex> lock(mutex);
+    if (traces.empty()) {
+        return;
+    }
+    auto& config = Config::instance();
+
+    const auto elapsed = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - trace_start_time).count();
+    const double tsc_per_us = (__builtin_ia32_rdtsc() - trace_start_tsc) / elapsed;
+
+    std::ofstream json{config.trace_file};
+    json << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n";
+    bool first_event = true;
+    for (auto& info : traces) {
+        // ring may have overwritten the begin of a still open span
+        std::array<uint64_t, Trace::__MAX> depth{};
+        for (auto& e : info.events) {
+            if (e.phase == Trace::BEGIN) {
+                ++depth[e.name];
+            } else if (e.phase == Trace::END) {
+                if (depth[e.name] == 0) {
+                    continue;
+                }
+                --depth[e.name];
+            }
+            static constexpr std::array<char, 3> phases{'B', 'E', 'i'};
+            auto ts = (static_cast<int64_t>(e.tsc - trace_start_tsc)) / tsc_per_us;
+            json << (first_event ? "" : ",\n") << "{\"name\":\"" << Trace::enum2str[e.name] << "\",\"ph\":\"" << phases[e.phase]
+                 << "\",\"ts\":" << std::fixed << ts << ",\"pid\":" << config.node_id << ",\"tid\":" << info.tid
+                 << ",\"args\":{\"arg\":" << e.arg << "}}";
+            first_event = false;
+        }
+    }
+    json << "\n]}\n";
+    std::cout << "Wrote trace to " << config.trace_file << '\n';
+}
+
+void StatsCollector::print_perf() {
+    const std::lock_guard<std::mutex> lock(mutex);
+    if (sum_perf_commits == 0) {
+        return;
+    }
+
+    std::stringstream ss;
+    ss << "*** Perf Summary (" << Config::instance().workload << ", per committed txn) ***\n";
+    for (size_t i = 0; auto& phase : Cycles::enum2str) {
+        auto& sums = sum_perf[i++];
+        if (sums[Perf::cycles] == 0) {
+            continue;
+        }
+        ss << phase << "_ipc=" << static_cast<double>(sums[Perf::instructions]) / sums[Perf::cycles] << '\n';
+        for (size_t j = 0; auto& event : Perf::enum2str) {
+            ss << phase << '_' << event << '=' << static_cast<double>(sums[j++]) / sum_perf_commits << '\n';
+        }
+    }
+    std::cout << ss.str();
+}
+
+} // namespace stats
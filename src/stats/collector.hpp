@@ -1,15 +1,25 @@
 #pragma once
 
+#include "aborts.hpp"
 #include "counter.hpp"
 #include "cycles.hpp"
-#include "moving_avg.hpp"
+#include "metrics_server.hpp"
 #include "periodic.hpp"
+#include "trace.hpp"
 
 #include <array>
+#include <chrono>
 #include <cstdint>
+#include <functional>
+#include <memory>
 #include <mutex>
+#include <ostream>
 #include <sstream>
+#include <string>
+#include <string_view>
 #include <thread>
+#include <unordered_map>
+#include <utility>
 #include <vector>
 
 
@@ -24,6 +34,10 @@ struct StatsCollector {
 
     static StatsCollector& get();
 
+    // set before the first get(): stats are still registered, but nothing is
+    // sampled, served, printed or written (e.g. by the microbenchmarks)
+    static inline bool disabled = false;
+
     std::vector<Counter*> cntrs;
     std::array<uint64_t, Counter::__MAX> sum_counters{};
     void reg(Counter* cntr);
@@ -48,21 +62,68 @@ struct StatsCollector {
     };
 
     struct CyclesInfo {
-        using avg_t = MovingAverage<uint64_t, uint64_t, 1024>;
-        // using avg_t = TotalAverage<uint64_t>;
+        using avg_t = TotalAverage<uint64_t>;
         Cycles* cycles;
         std::array<avg_t, Cycles::__MAX> avgs{};
     };
     std::vector<CyclesInfo> cycles;
     std::array<TotalAverage<double>, Cycles::__MAX> avg_cycles{};
+    std::unique_ptr<Cycles::Histograms> retired_hists = std::make_unique<Cycles::Histograms>();
+    std::vector<std::string_view> txn_names;
 
     void reg(Cycles* c);
     void dereg(Cycles* c);
+    void set_txn_names(const std::vector<std::string_view>& names);
 
     std::vector<Periodic*> pcntrs;
     std::array<uint64_t, Periodic::__MAX> last_pcntrs{};
     void reg(Periodic* cntr);
     void dereg(Periodic* cntr);
+
+    // external sources for the periodic csv (e.g. NIC statistics), called with
+    // the mutex held every STATS_PERIODIC_SAMPLE_TIME
+    using Sample = std::pair<std::string, uint64_t>;
+    using Sampler = std::function<void(std::vector<Sample>& samples)>;
+    std::vector<std::pair<const void*, Sampler>> samplers;
+    std::vector<Sample> last_samples; // latest values of all samplers
+    void reg(const void* owner, Sampler sampler);
+    void dereg(const void* owner);
+
+    std::vector<Aborts*> abort_stats;
+    std::array<uint64_t, Aborts::__MAX> sum_aborts{};
+    uint64_t sum_untracked_keys = 0;
+    std::unordered_map<Aborts::KeyId, Aborts::KeyStats, Aborts::KeyIdHash> abort_keys;
+    std::unordered_map<Aborts::CallSite, Aborts::SiteStats, Aborts::CallSiteHash> abort_sites;
+    std::vector<std::pair<uint32_t, Aborts::Record>> abort_samples; // (tid, record)
+    std::vector<std::string> table_names;
+    void reg(Aborts* a);
+    void dereg(Aborts* a);
+    void set_table_name(uint64_t id, const std::string& name);
+
+    struct TraceInfo {
+        uint32_t tid;
+        std::vector<Trace::Event> events;
+    };
+    std::vector<TraceInfo> traces;
+    uint64_t trace_start_tsc = 0; // for tsc -> µs conversion
+    std::chrono::steady_clock::time_point trace_start_time;
+    void reg(Trace* t);
+    void dereg(Trace* t);
+
+    std::array<Perf::Values, Perf::MAX_PHASES> sum_perf{};
+    uint64_t sum_perf_commits = 0;
+    void dereg(Perf* p); // only totals are reported, no periodic sampling
+
+    // current state in Prometheus text format, served by MetricsServer
+    void write_metrics(std::ostream& os);
+    std::unique_ptr<MetricsServer> metrics;
+
+private:
+    void merge_hists(Cycles::Histograms& dest); // requires mutex
+    void write_hists(std::ostream& os, const std::string& prefix, const Cycles::Histograms& hists);
+    void print_aborts();
+    void write_trace();
+    void print_perf();
 };
 
 } // namespace stats
@@ -3,6 +3,7 @@
 
 void WorkerContext::init() {
     context = new WorkerContext();
+    context->refresh_stats();
 }
 
 void WorkerContext::deinit() {
@@ -1,8 +1,11 @@
 #pragma once
 
+#include "aborts.hpp"
 #include "counter.hpp"
 #include "cycles.hpp"
 #include "periodic.hpp"
+#include "toggle.hpp"
+#include "trace.hpp"
 
 
 struct WorkerContext {
@@ -19,9 +22,25 @@ struct WorkerContext {
 
     static WorkerContext& get(); // requires constructed object in thread_local
 
+    // picks up runtime changes of the stats mask, call at txn boundaries
+    void refresh_stats() {
+        auto mask = stats::Toggle::get();
+        if (mask == stats_mask) [[likely]] {
+            return;
+        }
+        stats_mask = mask;
+        cntr.enabled = mask & StatsBitmask::COUNTER;
+        cycl.enabled = mask & StatsBitmask::CYCLES;
+        pcntr.enabled = mask & StatsBitmask::PERIODIC;
+        aborts.enabled = mask & StatsBitmask::ABORTS;
+    }
+
 
     uint32_t tid;
     stats::Counter cntr;
     stats::Cycles cycl;
     stats::Periodic pcntr;
+    stats::Aborts aborts;
+    stats::Trace trace;
+    StatsBitmask stats_mask = StatsBitmask::NONE;
 };
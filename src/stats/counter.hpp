@@ -23,6 +23,11 @@ struct Counter {
         remote_lock_success,
         remote_lock_waiting,
         switch_aborts,
+        msg_retransmits,
+        msg_timeouts,
+        msg_duplicates,
+        msg_dropped,
+        put_row_waits,
 
         tpcc_no_txns,
         tpcc_no_warehouse_read,
@@ -70,6 +75,11 @@ struct Counter {
         "remote_lock_success",
         "remote_lock_waiting",
         "switch_aborts",
+        "msg_retransmits",
+        "msg_timeouts",
+        "msg_duplicates",
+        "msg_dropped",
+        "put_row_waits",
 
         "tpcc_no_txns",
         "tpcc_no_warehouse_read",
@@ -108,6 +118,7 @@ struct Counter {
 
     // std::atomic<uint64_t> counters[__MAX]{};
     std::array<uint64_t, __MAX> counters{};
+    bool enabled = false; // runtime switch, see stats::Toggle
 
 
 #define __forceinline inline __attribute__((always_inline))
@@ -116,6 +127,9 @@ struct Counter {
         if constexpr (!(ENABLED_STATS & StatsBitmask::COUNTER)) {
             return;
         }
+        if (!enabled) {
+            return;
+        }
         auto& cntr = counters[name];
         // auto local = cntr.load();
         // ++local;
@@ -127,6 +141,9 @@ struct Counter {
         if constexpr (!(ENABLED_STATS & StatsBitmask::COUNTER)) {
             return;
         }
+        if (!enabled) {
+            return;
+        }
         auto& cntr = counters[name];
         cntr += amount;
     }
@@ -11,6 +11,7 @@ Cycles::Cycles() {
     if constexpr (!(ENABLED_STATS & StatsBitmask::CYCLES)) {
         return;
     }
+    hists = std::make_unique<Histograms>();
     StatsCollector::get().reg(this);
 }
 
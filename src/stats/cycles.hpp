@@ -2,9 +2,12 @@
 
 #include "db/defs.hpp"
 #include "db/util.hpp"
+#include "histogram.hpp"
+#include "perf.hpp"
 
 #include <array>
 #include <atomic>
+#include <memory>
 #include <string_view>
 #if defined(__x86_64__)
 #include <x86intrin.h>
@@ -42,14 +45,29 @@ struct Cycles {
     };
     std::array<Entry, __MAX> cycles{};
 
+    // per txn type (variant index of Arg_t) distribution of saved cycles
+    static constexpr std::size_t MAX_TXN_TYPES = 8;
+    using Histograms = std::array<std::array<Histogram, __MAX>, MAX_TXN_TYPES>;
+    std::unique_ptr<Histograms> hists;
+    std::size_t txn_type = 0;
+    bool enabled = false; // runtime switch, see stats::Toggle
+
+    // hardware counters for the same phases, independent of CYCLES
+    Perf perf;
+    static_assert(__MAX <= Perf::MAX_PHASES);
+
 
 #define __forceinline inline __attribute__((always_inline))
 
 
     __forceinline void start(const Name name [[maybe_unused]]) {
+        perf.start(name);
         if constexpr (!(ENABLED_STATS & StatsBitmask::CYCLES)) {
             return;
         }
+        if (!enabled) {
+            return;
+        }
 #if defined(__x86_64__)
         auto& lat = cycles[name];
         // _mm_lfence();  // optionally wait for earlier insns to retire before reading the clock
@@ -59,9 +77,13 @@ struct Cycles {
     }
 
     __forceinline void stop(const Name name [[maybe_unused]]) {
+        perf.stop(name);
         if constexpr (!(ENABLED_STATS & StatsBitmask::CYCLES)) {
             return;
         }
+        if (!enabled) {
+            return;
+        }
 #if defined(__x86_64__)
         auto& lat = cycles[name];
         auto cycles = __builtin_ia32_rdtsc() - lat.start;
@@ -73,17 +95,36 @@ struct Cycles {
         if constexpr (!(ENABLED_STATS & StatsBitmask::CYCLES)) {
             return;
         }
+        if (!enabled) {
+            return;
+        }
 #if defined(__x86_64__)
         auto& lat = cycles[name];
         // lat.cycles.store(lat.sum, std::memory_order_relaxed);
         lat.cycles.fetch_add(lat.sum, std::memory_order_relaxed);
+        if (lat.sum > 0) { // phase not part of this txn, e.g. no remote access
+            (*hists)[txn_type][name].add(lat.sum);
+        }
 #endif
     }
 
+    __forceinline void set_txn_type(const std::size_t type [[maybe_unused]]) {
+        if constexpr (!(ENABLED_STATS & StatsBitmask::CYCLES)) {
+            return;
+        }
+        if (!enabled) {
+            return;
+        }
+        txn_type = type;
+    }
+
     __forceinline void reset(const Name name [[maybe_unused]]) {
         if constexpr (!(ENABLED_STATS & StatsBitmask::CYCLES)) {
             return;
         }
+        if (!enabled) {
+            return;
+        }
         auto& lat = cycles[name];
         lat.sum = 0;
     }
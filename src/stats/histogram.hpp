@@ -0,0 +1,106 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+
+
+namespace stats {
+
+// Log-linear histogram in the style of HdrHistogram. Values below SUB_BUCKETS
+// are counted exactly, every following power of two is split into SUB_BUCKETS
+// equally wide buckets, so the relative error stays below 1/SUB_BUCKETS.
+// Single writer, but safe to read (and merge) from other threads.
+struct Histogram {
+    static constexpr unsigned SUB_BITS = 5;
+    static constexpr uint64_t SUB_BUCKETS = 1ul << SUB_BITS;
+    static constexpr std::size_t NUM_BUCKETS = (64 - SUB_BITS + 1) * SUB_BUCKETS;
+
+    std::array<uint64_t, NUM_BUCKETS> buckets{};
+    uint64_t value_sum = 0; // exact sum of all values, buckets only bound them
+
+
+    static constexpr std::size_t index(uint64_t value) {
+        if (value < SUB_BUCKETS) {
+            return value;
+        }
+        const unsigned msb = 63 - __builtin_clzll(value);
+        const unsigned group = msb - SUB_BITS + 1;
+        const uint64_t sub = (value >> (msb - SUB_BITS)) - SUB_BUCKETS;
+        return group * SUB_BUCKETS + sub;
+    }
+
+    // highest value that is counted in bucket at idx
+    static constexpr uint64_t upper_bound(std::size_t idx) {
+        const uint64_t group = idx / SUB_BUCKETS;
+        const uint64_t sub = idx % SUB_BUCKETS;
+        if (group == 0) {
+            return sub;
+        }
+        const uint64_t lower = (SUB_BUCKETS + sub) << (group - 1);
+        return lower + ((1ul << (group - 1)) - 1);
+    }
+
+
+    void add(uint64_t value) {
+        std::atomic_ref<uint64_t> cnt{buckets[index(value)]};
+        cnt.store(cnt.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        std::atomic_ref<uint64_t> sum{value_sum};
+        sum.store(sum.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+    }
+
+    void merge(Histogram& other) {
+        for (std::size_t i = 0; i < NUM_BUCKETS; ++i) {
+            buckets[i] += std::atomic_ref<uint64_t>{other.buckets[i]}.load(std::memory_order_relaxed);
+        }
+        value_sum += std::atomic_ref<uint64_t>{other.value_sum}.load(std::memory_order_relaxed);
+    }
+
+    void subtract(const Histogram& other) {
+        for (std::size_t i = 0; i < NUM_BUCKETS; ++i) {
+            buckets[i] -= other.buckets[i];
+        }
+        value_sum -= other.value_sum;
+    }
+
+    void clear() {
+        buckets.fill(0);
+        value_sum = 0;
+    }
+
+    uint64_t count() const {
+        uint64_t total = 0;
+        for (auto& b : buckets) {
+            total += b;
+        }
+        return total;
+    }
+
+    uint64_t sum() const {
+        return value_sum;
+    }
+
+    // p in [0.0, 1.0], returns 0 for an empty histogram
+    uint64_t percentile(double p) const {
+        const uint64_t total = count();
+        if (total == 0) {
+            return 0;
+        }
+        const uint64_t rank = std::max<uint64_t>(1, std::ceil(p * total));
+        uint64_t seen = 0;
+        for (std::size_t i = 0; i < NUM_BUCKETS; ++i) {
+            seen += buckets[i];
+            if (seen >= rank) {
+                return upper_bound(i);
+            }
+        }
+        return upper_bound(NUM_BUCKETS - 1);
+    }
+};
+
+static_assert(Histogram::index(~0ul) == Histogram::NUM_BUCKETS - 1);
+static_assert(Histogram::upper_bound(Histogram::index(1000)) >= 1000);
+
+} // namespace stats
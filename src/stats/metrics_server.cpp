@@ -0,0 +1,120 @@
+#include "metrics_server.hpp"
+
+#include <arpa/inet.h>
+#include <cerrno>
+#include <cstring>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sstream>
+#include <stdexcept>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+
+namespace stats {
+
+MetricsServer::MetricsServer(const std::string& unix_path, uint16_t tcp_port, Writer writer)
+    : is_http(unix_path.empty()), unix_path(unix_path), writer(std::move(writer)) {
+    auto fail = [this](const std::string& what) { // a throwing constructor skips the destructor
+        auto msg = what + ": " + std::strerror(errno);
+        if (fd >= 0) {
+            ::close(fd);
+        }
+        throw std::runtime_error(msg);
+    };
+
+    if (!is_http) {
+        sockaddr_un addr{};
+        addr.sun_family = AF_UNIX;
+        if (unix_path.size() >= sizeof(addr.sun_path)) {
+            throw std::runtime_error("metrics socket path too long");
+        }
+        std::strcpy(addr.sun_path, unix_path.c_str());
+        ::unlink(unix_path.c_str()); // stale socket of a previous run
+
+        fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+        if (fd < 0 || ::bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0) {
+            fail("metrics socket bind failed");
+        }
+    } else {
+        sockaddr_in addr{};
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(tcp_port);
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+        fd = ::socket(AF_INET, SOCK_STREAM, 0);
+        int one = 1;
+        if (fd < 0 || ::setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one)) < 0 ||
+            ::bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0) {
+            fail("metrics port bind failed");
+        }
+    }
+    if (::listen(fd, 4) < 0) {
+        fail("metrics listen failed");
+    }
+
+    thread = std::jthread([&](std::stop_token token) {
+        serve(token);
+    });
+}
+
+MetricsServer::~MetricsServer() {
+    thread.request_stop();
+    if (thread.joinable()) {
+        thread.join();
+    }
+    if (fd >= 0) {
+        ::close(fd);
+    }
+    if (!unix_path.empty()) {
+        ::unlink(unix_path.c_str());
+    }
+}
+
+
+void MetricsServer::serve(std::stop_token token) {
+    pollfd pfd{fd, POLLIN, 0};
+    while (!token.stop_requested()) {
+        if (::poll(&pfd, 1, 100 /*ms*/) <= 0) {
+            continue;
+        }
+        int client = ::accept(fd, nullptr, nullptr);
+        if (client < 0) {
+            continue;
+        }
+        respond(client);
+        ::close(client);
+    }
+}
+
+void MetricsServer::respond(int client) {
+    if (is_http) { // consume request, we serve the same page for every path
+        char buf[4096];
+        pollfd pfd{client, POLLIN, 0};
+        if (::poll(&pfd, 1, 100 /*ms*/) > 0) {
+            [[maybe_unused]] auto n = ::recv(client, buf, sizeof(buf), 0);
+        }
+    }
+
+    std::stringstream body;
+    writer(body);
+    auto text = body.str();
+
+    std::string msg;
+    if (is_http) {
+        msg = "HTTP/1.0 200 OK\r\nContent-Type: text/plain; version=0.0.4\r\nContent-Length: " +
+              std::to_string(text.size()) + "\r\n\r\n";
+    }
+    msg += text;
+
+    for (size_t sent = 0; sent < msg.size();) {
+        auto n = ::send(client, msg.data() + sent, msg.size() - sent, MSG_NOSIGNAL);
+        if (n <= 0) {
+            return;
+        }
+        sent += n;
+    }
+}
+
+} // namespace stats
@@ -0,0 +1,39 @@
+#pragma once
+
+
+#include <cstdint>
+#include <functional>
+#include <ostream>
+#include <stop_token>
+#include <string>
+#include <thread>
+
+
+namespace stats {
+
+// Serves the current metrics in Prometheus text exposition format, either on
+// a Unix domain socket (plain text, e.g. `socat - UNIX-CONNECT:<path>`) or on
+// a localhost TCP port (HTTP, scrapeable by Prometheus). One connection is
+// answered at a time, the body is produced by the writer callback.
+class MetricsServer {
+public:
+    using Writer = std::function<void(std::ostream& os)>;
+
+    MetricsServer(const std::string& unix_path, uint16_t tcp_port, Writer writer);
+    ~MetricsServer();
+
+    MetricsServer(const MetricsServer&) = delete;
+    MetricsServer& operator=(const MetricsServer&) = delete;
+
+private:
+    int fd = -1;
+    bool is_http;
+    std::string unix_path;
+    Writer writer;
+    std::jthread thread;
+
+    void serve(std::stop_token token);
+    void respond(int client);
+};
+
+} // namespace stats
@@ -0,0 +1,132 @@
+#include "perf.hpp"
+
+#include "collector.hpp"
+
+#include <atomic>
+#include <cstring>
+#include <iostream>
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+
+namespace stats {
+
+namespace {
+
+constexpr std::array<std::pair<uint32_t, uint64_t>, Perf::__MAX> event_configs{{
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES},
+    {PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_DTLB | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16)},
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES},
+}};
+
+int perf_event_open(perf_event_attr* attr, int group_fd) {
+    return static_cast<int>(syscall(SYS_perf_event_open, attr, 0, -1, group_fd, 0)); // this thread, any cpu
+}
+
+// see "mmap layout" in perf_event_open(2)
+uint64_t read_rdpmc(const perf_event_mmap_page* pc) {
+    uint32_t seq;
+    uint64_t count;
+    do {
+        seq = pc->lock;
+        std::atomic_signal_fence(std::memory_order_acq_rel);
+        const uint32_t idx = pc->index;
+        count = pc->offset;
+        if (pc->cap_user_rdpmc && idx) {
+            const uint16_t width = pc->pmc_width;
+            int64_t pmc = __builtin_ia32_rdpmc(idx - 1);
+            pmc <<= 64 - width; // sign extend
+            pmc >>= 64 - width;
+            count += pmc;
+        }
+        std::atomic_signal_fence(std::memory_order_acq_rel);
+    } while (pc->lock != seq);
+    return count;
+}
+
+} // namespace
+
+
+Perf::Perf() {
+    if constexpr (!(ENABLED_STATS & StatsBitmask::PERF)) {
+        return;
+    }
+    fds.fill(-1);
+    pages.fill(nullptr);
+
+    const long page_size = sysconf(_SC_PAGESIZE);
+    for (size_t i = 0; i < __MAX; ++i) {
+        perf_event_attr attr;
+        std::memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.type = event_configs[i].first;
+        attr.config = event_configs[i].second;
+        attr.disabled = (i == 0); // group starts with leader
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+
+        fds[i] = perf_event_open(&attr, (i == 0) ? -1 : fds[0]);
+        if (fds[i] < 0) {
+            std::cerr << "perf_event_open failed for " << enum2str[i] << ": " << std::strerror(errno) << ", disabling perf stats\n";
+            close_all();
+            return;
+        }
+        void* page = mmap(nullptr, page_size, PROT_READ, MAP_SHARED, fds[i], 0);
+        if (page == MAP_FAILED) {
+            std::cerr << "mmap of perf page failed: " << std::strerror(errno) << ", disabling perf stats\n";
+            close_all();
+            return;
+        }
+        pages[i] = static_cast<perf_event_mmap_page*>(page);
+    }
+    if (!pages[0]->cap_user_rdpmc) {
+        std::cerr << "rdpmc not permitted (see /sys/devices/cpu/rdpmc), disabling perf stats\n";
+        close_all();
+        return;
+    }
+
+    ioctl(fds[0], PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+    ioctl(fds[0], PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+    enabled = true;
+}
+
+Perf::~Perf() {
+    if constexpr (!(ENABLED_STATS & StatsBitmask::PERF)) {
+        return;
+    }
+    if (!enabled) {
+        return;
+    }
+    ioctl(fds[0], PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+    StatsCollector::get().dereg(this);
+    close_all();
+}
+
+
+void Perf::read(Values& values) const {
+    for (size_t i = 0; i < __MAX; ++i) {
+        values[i] = read_rdpmc(pages[i]);
+    }
+}
+
+void Perf::close_all() {
+    const long page_size = sysconf(_SC_PAGESIZE);
+    for (size_t i = 0; i < __MAX; ++i) {
+        if (pages[i]) {
+            munmap(pages[i], page_size);
+            pages[i] = nullptr;
+        }
+        if (fds[i] >= 0) {
+            close(fds[i]);
+            fds[i] = -1;
+        }
+    }
+    enabled = false;
+}
+
+} // namespace stats
@@ -0,0 +1,91 @@
+#pragma once
+
+
+#include "db/defs.hpp"
+
+#include <array>
+#include <cstdint>
+#include <string_view>
+
+struct perf_event_mmap_page;
+
+
+namespace stats {
+
+// Per-thread hardware counters (perf_event_open group) attributed to the
+// phases of stats::Cycles. Counters are read in userspace with rdpmc via the
+// mmap'ed control page, so start()/stop() stay syscall-free. If the kernel
+// refuses the events (perf_event_paranoid, no PMU in VMs) counting is
+// disabled with a warning.
+struct Perf {
+    Perf();
+    ~Perf();
+
+    enum Event {
+        cycles,
+        instructions,
+        llc_misses,
+        dtlb_misses,
+        branch_misses,
+        __MAX
+    };
+
+    static constexpr std::array<std::string_view, __MAX> enum2str{
+        "cycles",
+        "instructions",
+        "llc_misses",
+        "dtlb_misses",
+        "branch_misses",
+    };
+
+    static constexpr std::size_t MAX_PHASES = 8; // >= Cycles::__MAX
+
+    using Values = std::array<uint64_t, __MAX>;
+    std::array<Values, MAX_PHASES> start_values{};
+    std::array<Values, MAX_PHASES> sums{};
+    uint64_t commits = 0;
+    bool enabled = false;
+
+
+#define __forceinline inline __attribute__((always_inline))
+
+    __forceinline void start(const std::size_t phase [[maybe_unused]]) {
+        if constexpr (!(ENABLED_STATS & StatsBitmask::PERF)) {
+            return;
+        }
+        if (!enabled) {
+            return;
+        }
+        read(start_values[phase]);
+    }
+
+    __forceinline void stop(const std::size_t phase [[maybe_unused]]) {
+        if constexpr (!(ENABLED_STATS & StatsBitmask::PERF)) {
+            return;
+        }
+        if (!enabled) {
+            return;
+        }
+        Values now;
+        read(now);
+        for (std::size_t i = 0; i < __MAX; ++i) {
+            sums[phase][i] += now[i] - start_values[phase][i];
+        }
+    }
+
+    __forceinline void commit() {
+        if constexpr (!(ENABLED_STATS & StatsBitmask::PERF)) {
+            return;
+        }
+        ++commits;
+    }
+
+private:
+    std::array<int, __MAX> fds{};
+    std::array<perf_event_mmap_page*, __MAX> pages{};
+
+    void read(Values& values) const;
+    void close_all();
+};
+
+} // namespace stats
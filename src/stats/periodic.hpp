@@ -26,6 +26,7 @@ struct Periodic {
     };
 
     std::atomic<uint64_t> counters[__MAX]{};
+    bool enabled = false; // runtime switch, see stats::Toggle
 
 
 #define __forceinline inline __attribute__((always_inline))
@@ -34,10 +35,11 @@ struct Periodic {
         if constexpr (!(ENABLED_STATS & StatsBitmask::PERIODIC)) {
             return;
         }
-        auto& cntr = counters[name];
-        auto local = cntr.load(std::memory_order_release);
-        ++local;
-        cntr.store(local, std::memory_order_relaxed);
+        if (!enabled) {
+            return;
+        }
+        auto& cntr = counters[name]; // single writer, no rmw needed
+        cntr.store(cntr.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
     }
 };
 
@@ -0,0 +1,23 @@
+#include "toggle.hpp"
+
+#include <csignal>
+
+
+namespace stats {
+
+void Toggle::set(StatsBitmask mask) {
+    using T = std::underlying_type<StatsBitmask>::type;
+    configured.store(static_cast<T>(mask), std::memory_order_relaxed);
+    active.store(static_cast<T>(mask), std::memory_order_relaxed);
+}
+
+void Toggle::install_signal_handler() {
+    std::signal(SIGUSR1, &Toggle::on_signal);
+}
+
+void Toggle::on_signal(int) { // async-signal-safe, lock-free atomics only
+    auto mask = active.load(std::memory_order_relaxed);
+    active.store(mask ? 0 : configured.load(std::memory_order_relaxed), std::memory_order_relaxed);
+}
+
+} // namespace stats
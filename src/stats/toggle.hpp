@@ -0,0 +1,37 @@
+#pragma once
+
+
+#include "db/defs.hpp"
+
+#include <atomic>
+#include <cstdint>
+
+
+namespace stats {
+
+// Stats compiled in via ENABLED_STATS can be switched at runtime (--stats,
+// SIGUSR1). Threads copy the mask into per-thread flags at their next refresh
+// (txn start, msg-handler poll), so the hot path only tests a local bool.
+struct Toggle {
+    static StatsBitmask get() {
+        return static_cast<StatsBitmask>(active.load(std::memory_order_relaxed));
+    }
+
+    static StatsBitmask get_configured() {
+        return static_cast<StatsBitmask>(configured.load(std::memory_order_relaxed));
+    }
+
+    static void set(StatsBitmask mask);
+
+    // SIGUSR1 switches between the configured mask and StatsBitmask::NONE
+    static void install_signal_handler();
+
+private:
+    inline static std::atomic<uint64_t> active{0};
+    inline static std::atomic<uint64_t> configured{0};
+    static_assert(std::atomic<uint64_t>::is_always_lock_free); // used in signal handler
+
+    static void on_signal(int);
+};
+
+} // namespace stats
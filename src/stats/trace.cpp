@@ -0,0 +1,31 @@
+#include "trace.hpp"
+
+#include "collector.hpp"
+#include "db/config.hpp"
+
+
+namespace stats {
+
+Trace::Trace() {
+    if constexpr (!(ENABLED_STATS & StatsBitmask::TRACE)) {
+        return;
+    }
+    enabled = !Config::instance().trace_file.empty();
+    if (!enabled) {
+        return;
+    }
+    ring = std::make_unique<Event[]>(RING_SIZE);
+    StatsCollector::get().reg(this);
+}
+
+Trace::~Trace() {
+    if constexpr (!(ENABLED_STATS & StatsBitmask::TRACE)) {
+        return;
+    }
+    if (!enabled) {
+        return;
+    }
+    StatsCollector::get().dereg(this);
+}
+
+} // namespace stats
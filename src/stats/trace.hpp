@@ -0,0 +1,119 @@
+#pragma once
+
+
+#include "db/defs.hpp"
+#include "db/util.hpp"
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string_view>
+#if defined(__x86_64__)
+#include <x86intrin.h>
+#endif
+
+
+namespace stats {
+
+// Per-thread timeline of rdtsc-stamped begin/end events, written to a
+// Chrome trace (chrome://tracing, ui.perfetto.dev) on shutdown. Each thread
+// owns its ring, the owner is the only writer and old events are
+// overwritten, so tracing never blocks. Runtime opt-in via --trace_file.
+struct Trace {
+    Trace();
+    ~Trace();
+
+    enum Name : uint8_t {
+        txn,
+        local_lock,
+        remote_access,
+        switch_txn,
+        undo_clear,
+        put_res_wait,
+        handle_get_req,
+        handle_get_res,
+        handle_put_req,
+        __MAX
+    };
+
+    static constexpr std::array<std::string_view, __MAX> enum2str{
+        "txn",
+        "local_lock",
+        "remote_access",
+        "switch_txn",
+        "undo_clear",
+        "put_res_wait",
+        "handle_get_req",
+        "handle_get_res",
+        "handle_put_req",
+    };
+
+    enum Phase : uint8_t {
+        BEGIN,
+        END,
+        INSTANT,
+    };
+
+    struct Event {
+        uint64_t tsc;
+        uint32_t arg;
+        Name name;
+        Phase phase;
+    };
+
+    static constexpr std::size_t RING_SIZE = 1 << 16; // per thread, power of 2
+    static_assert((RING_SIZE & (RING_SIZE - 1)) == 0);
+
+    std::unique_ptr<Event[]> ring;
+    std::atomic<uint64_t> head{0}; // total events written
+    bool enabled = false;
+
+
+    struct Scope {
+        Trace& trace;
+        const Name name;
+        Scope(Trace& trace, Name name, uint32_t arg) : trace(trace), name(name) {
+            trace.begin(name, arg);
+        }
+        ~Scope() {
+            trace.end(name);
+        }
+    };
+
+
+#define __forceinline inline __attribute__((always_inline))
+
+    __forceinline void begin(const Name name [[maybe_unused]], const uint32_t arg [[maybe_unused]] = 0) {
+        add(name, BEGIN, arg);
+    }
+
+    __forceinline void end(const Name name [[maybe_unused]], const uint32_t arg [[maybe_unused]] = 0) {
+        add(name, END, arg);
+    }
+
+    __forceinline void instant(const Name name [[maybe_unused]], const uint32_t arg [[maybe_unused]] = 0) {
+        add(name, INSTANT, arg);
+    }
+
+    [[nodiscard]] __forceinline Scope scope(const Name name, const uint32_t arg = 0) {
+        return Scope{*this, name, arg};
+    }
+
+private:
+    __forceinline void add(const Name name [[maybe_unused]], const Phase phase [[maybe_unused]], const uint32_t arg [[maybe_unused]]) {
+        if constexpr (!(ENABLED_STATS & StatsBitmask::TRACE)) {
+            return;
+        }
+#if defined(__x86_64__)
+        if (!enabled) {
+            return;
+        }
+        auto pos = head.load(std::memory_order_relaxed);
+        ring[pos & (RING_SIZE - 1)] = Event{__builtin_ia32_rdtsc(), arg, name, phase};
+        head.store(pos + 1, std::memory_order_release);
+#endif
+    }
+};
+
+} // namespace stats
@@ -0,0 +1,61 @@
+#include "access_sketch.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+
+std::vector<AccessSketch::Bucket> AccessSketch::snapshot() const {
+    std::vector<Bucket> res;
+    for (std::size_t i = 0; i < NUM_BUCKETS; ++i) {
+        auto accesses = buckets[i].accesses.load(std::memory_order_relaxed) * SAMPLE_RATE;
+        auto conflicts = buckets[i].conflicts.load(std::memory_order_relaxed);
+        if (accesses == 0 && conflicts == 0) {
+            continue;
+        }
+        auto first_index = (i == 0) ? 0 : stats::Histogram::upper_bound(i - 1) + 1;
+        res.emplace_back(Bucket{first_index, stats::Histogram::upper_bound(i), accesses, conflicts});
+    }
+    return res;
+}
+
+
+uint64_t AccessSketch::hot_set_size(double fraction) const {
+    auto hot = snapshot();
+    uint64_t total = 0;
+    for (auto& b : hot) {
+        total += b.accesses;
+    }
+    if (total == 0) {
+        return 0;
+    }
+
+    // densest buckets first, rows within a bucket are assumed equally hot
+    auto density = [](const Bucket& b) {
+        return static_cast<double>(b.accesses) / (b.last_index - b.first_index + 1);
+    };
+    std::sort(hot.begin(), hot.end(), [&](auto& lhs, auto& rhs) {
+        return density(lhs) > density(rhs);
+    });
+
+    const double target = fraction * total;
+    double covered = 0.0;
+    uint64_t rows = 0;
+    for (auto& b : hot) {
+        const uint64_t width = b.last_index - b.first_index + 1;
+        if (covered + b.accesses >= target) {
+            rows += static_cast<uint64_t>(std::ceil((target - covered) / density(b)));
+            break;
+        }
+        covered += b.accesses;
+        rows += width;
+    }
+    return rows;
+}
+
+
+void AccessSketch::write_csv(std::ostream& os, uint32_t node_id, const std::string& table) const {
+    for (auto& b : snapshot()) {
+        os << node_id << ',' << table << ',' << b.first_index << ',' << b.last_index << ','
+           << b.accesses << ',' << b.conflicts << '\n';
+    }
+}
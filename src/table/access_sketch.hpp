@@ -0,0 +1,76 @@
+#pragma once
+
+#include "db/defs.hpp"
+#include "stats/histogram.hpp"
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+
+// Sampled access and conflict frequencies per bucket of partition-local row
+// indices, i.e. the index space hot_size and switch_entries are defined in.
+// Buckets are log-linear (see stats::Histogram): exact for the first rows,
+// then ~3% wide, so a hot prefix can be sized precisely while the table
+// tail stays cheap. Safe to read while workers and msg-handler record.
+// Only compiled in with StatsBitmask::HEATMAP, otherwise tables hold a
+// NoAccessSketch.
+class AccessSketch {
+public:
+    static constexpr std::size_t NUM_BUCKETS = stats::Histogram::NUM_BUCKETS;
+    static constexpr uint32_t SAMPLE_RATE = 64; // count every n-th access per thread, power of 2
+    static_assert((SAMPLE_RATE & (SAMPLE_RATE - 1)) == 0);
+
+    struct Bucket {
+        uint64_t first_index;
+        uint64_t last_index;
+        uint64_t accesses; // estimated, i.e. scaled by SAMPLE_RATE
+        uint64_t conflicts;
+    };
+
+
+    void record(const uint64_t local_index, const bool conflict) {
+        auto& bucket = buckets[stats::Histogram::index(local_index)];
+        if (conflict) [[unlikely]] { // rare compared to accesses, not sampled
+            bucket.conflicts.fetch_add(1, std::memory_order_relaxed);
+        }
+        if ((++sample_cntr & (SAMPLE_RATE - 1)) == 0) {
+            bucket.accesses.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+    // non-empty buckets in index order
+    std::vector<Bucket> snapshot() const;
+
+    // number of rows that receive `fraction` of all accesses, hottest buckets first
+    uint64_t hot_set_size(double fraction) const;
+
+    void write_csv(std::ostream& os, uint32_t node_id, const std::string& table) const;
+
+private:
+    struct Counts {
+        std::atomic<uint64_t> accesses{};
+        std::atomic<uint64_t> conflicts{};
+    };
+    std::array<Counts, NUM_BUCKETS> buckets{};
+
+    inline static thread_local uint32_t sample_cntr = 0;
+};
+
+// empty stand-in without HEATMAP, takes no space in Table
+struct NoAccessSketch {
+    void record(uint64_t, bool) {}
+
+    std::vector<AccessSketch::Bucket> snapshot() const {
+        return {};
+    }
+
+    uint64_t hot_set_size(double) const {
+        return 0;
+    }
+
+    void write_csv(std::ostream&, uint32_t, const std::string&) const {}
+};
@@ -4,6 +4,7 @@
 #include "db/future.hpp"
 #include "db/spinlock.hpp"
 #include "db/types.hpp"
+#include "remote.hpp"
 #include "row.hpp"
 #include "stats/stats.hpp"
 
@@ -69,32 +70,28 @@ struct Row<Tuple_t, CC_Scheme::NO_WAIT> {
         return ErrorCode::SUCCESS;
     }
 
-    void remote_lock(Communicator& comm, Communicator::Pkt_t* pkt, msg::TupleGetReq* req) {
+    ErrorCode remote_lock(Communicator& comm, Communicator::Pkt_t* pkt, msg::TupleMsgHeader* req) {
         WorkerContext::get().cycl.start(stats::Cycles::latch_contention);
         const std::lock_guard<lock_t> lock(mutex);
         WorkerContext::get().cycl.stop(stats::Cycles::latch_contention);
         // lock_t::scoped_lock lock;
         // lock.acquire(mutex);
 
+        const AccessMode mode = req->mode; // req is sent with the reply
 
-        if (!is_compatible(req->mode)) {
-            auto res = req->convert<msg::TupleGetRes>();
-            res->mode = AccessMode::INVALID;
-            comm.send(res->sender, pkt, comm.mh_tid); // always called from msg-handler
+        if (!is_compatible(mode)) {
+            const bool is_read = mode.get_clean() == AccessMode::READ;
+            refuse_remote(comm, pkt, comm.mh_tid); // always called from msg-handler
             WorkerContext::get().cntr.incr(stats::Counter::remote_lock_failed);
-            return;
+            return is_read ? ErrorCode::READ_LOCK_FAILED : ErrorCode::WRITE_LOCK_FAILED;
         }
 
-        ++owner_cnt;
-        lock_type = req->mode;
-
-        auto res = req->convert<msg::TupleGetRes>();
-        auto size = msg::TupleGetRes::size(sizeof(tuple));
-        pkt->resize(size);
-        std::memcpy(res->tuple, &tuple, sizeof(tuple));
-
         WorkerContext::get().cntr.incr(stats::Counter::remote_lock_success);
-        comm.send(res->sender, pkt, comm.mh_tid); // always called from msg-handler
+        if (grant_remote(comm, pkt, tuple, comm.mh_tid)) { // always called from msg-handler
+            ++owner_cnt;
+            lock_type = mode;
+        }
+        return ErrorCode::SUCCESS;
     }
 
     void remote_unlock(msg::TuplePutReq* req, Communicator& comm) {
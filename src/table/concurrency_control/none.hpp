@@ -3,6 +3,7 @@
 
 #include "db/future.hpp"
 #include "db/types.hpp"
+#include "remote.hpp"
 #include "row.hpp"
 #include "stats/stats.hpp"
 
@@ -23,14 +24,10 @@ struct Row<Tuple_t, CC_Scheme::NONE> {
         return ErrorCode::SUCCESS;
     }
 
-    void remote_lock(Communicator& comm, Communicator::Pkt_t* pkt, msg::TupleGetReq* req) {
-        auto res = req->convert<msg::TupleGetRes>();
-        auto size = msg::TupleGetRes::size(sizeof(tuple));
-        pkt->resize(size);
-        std::memcpy(res->tuple, &tuple, sizeof(tuple));
-
+    ErrorCode remote_lock(Communicator& comm, Communicator::Pkt_t* pkt, msg::TupleMsgHeader*) {
         WorkerContext::get().cntr.incr(stats::Counter::remote_lock_success);
-        comm.send(res->sender, pkt, comm.mh_tid); // always called from msg-handler
+        grant_remote(comm, pkt, tuple, comm.mh_tid); // always called from msg-handler
+        return ErrorCode::SUCCESS;
     }
 
     void remote_unlock(msg::TuplePutReq* req, Communicator& comm) {
@@ -0,0 +1,67 @@
+#pragma once
+
+
+#include "comm/handlers/reply_cache.hpp"
+#include "comm/handlers/tuple_call.hpp"
+#include "comm/msg.hpp"
+#include "db/defs.hpp"
+#include "db/fragment.hpp"
+
+#include <cstring>
+
+
+// Replies to a remote lock request (TupleGetReq or TupleCallReq) once it is
+// granted, shared by the concurrency control schemes. A get receives the tuple,
+// copied or with --zero_copy_bytes attached from the row, which is stable until
+// the requester releases the lock. A call runs its fragment on the tuple and
+// receives the result.
+// Returns whether the requester now holds the lock: not if it cancelled
+// meanwhile, nor if the fragment refused or committed right away.
+template <typename Tuple_t>
+bool grant_remote(Communicator& comm, Communicator::Pkt_t*& pkt, Tuple_t& tuple, uint32_t tid) {
+    auto msg = pkt->as<msg::Header>();
+    if (msg->type != msg::Type::TUPLE_CALL_REQ) [[likely]] {
+        auto res = msg->convert<msg::TupleGetRes>();
+        pkt->resize(msg::TupleGetRes::size(0));
+        if (!attach_payload(comm, pkt, &tuple, sizeof(tuple))) {
+            pkt->resize(msg::TupleGetRes::size(sizeof(tuple)));
+            std::memcpy(res->tuple, &tuple, sizeof(tuple));
+        }
+        return send_reply(comm, pkt, tid);
+    }
+
+    auto& fragment = fragments::Registry::get().at(msg->as<msg::TupleCallReq>()->proc);
+    const Tuple_t before = tuple;
+    auto res = msg->convert<msg::TupleCallRes>();
+    res->applied = fragment.apply(&tuple, res->result, res->result);
+    pkt->resize(msg::TupleCallRes::size(fragment.result_size));
+
+    const bool holds = res->applied && !res->autocommit;
+    const bool keeps_undo = CC_SCHEME != CC_Scheme::NONE && holds && res->mode == AccessMode::WRITE;
+    if (keeps_undo) { // before the reply, the release may come back right away
+        keep_undo(comm, res, &before, sizeof(before));
+    }
+    auto call = *static_cast<msg::Header*>(res); // pkt is gone after sending
+    if (!send_reply(comm, pkt, tid)) {
+        tuple = before;
+        if (keeps_undo) {
+            drop_undo(comm, &call);
+        }
+        return false;
+    }
+    return holds;
+}
+
+// Replies that the lock could not be granted.
+inline void refuse_remote(Communicator& comm, Communicator::Pkt_t*& pkt, uint32_t tid) {
+    auto msg = pkt->as<msg::Header>();
+    if (msg->type != msg::Type::TUPLE_CALL_REQ) [[likely]] {
+        msg->convert<msg::TupleGetRes>()->mode = AccessMode::INVALID;
+    } else {
+        auto res = msg->convert<msg::TupleCallRes>();
+        res->mode = AccessMode::INVALID;
+        res->applied = false;
+        pkt->resize(msg::TupleCallRes::size(0));
+    }
+    send_reply(comm, pkt, tid);
+}
@@ -5,6 +5,7 @@
 #include "db/future.hpp"
 #include "db/spinlock.hpp"
 #include "db/types.hpp"
+#include "remote.hpp"
 #include "row.hpp"
 #include "stats/stats.hpp"
 
@@ -35,8 +36,7 @@ struct Row<Tuple_t, CC_Scheme::WAIT_DIE> {
         }
     };
 
-    using lock_t = std::mutex;
-    // using lock_t = SpinLock;
+    using lock_t = SpinLock;
     lock_t mutex;
 
 
@@ -123,47 +123,45 @@ struct Row<Tuple_t, CC_Scheme::WAIT_DIE> {
         return ErrorCode::SUCCESS;
     }
 
-    void remote_lock(Communicator& comm, Communicator::Pkt_t* pkt, msg::TupleGetReq* req) {
+    ErrorCode remote_lock(Communicator& comm, Communicator::Pkt_t* pkt, msg::TupleMsgHeader* req) {
         const std::lock_guard<lock_t> lock(mutex);
 
-        bool conflict = !is_compatible(req->mode);
+        const AccessMode mode = req->mode; // req is sent with the reply
+        const timestamp_t ts = req->ts;
+
+        bool conflict = !is_compatible(mode);
         if (!conflict) {
-            conflict = !waiters.empty() && (req->ts < waiters.head->val.ts);
+            conflict = !waiters.empty() && (ts < waiters.head->val.ts);
         }
         if (!conflict) {
-            ++owner_cnt;
-            lock_type = req->mode;
-            owners.add_sorted(Owner{req->ts});
-
-            auto res = req->convert<msg::TupleGetRes>();
-            auto size = msg::TupleGetRes::size(sizeof(tuple));
-            pkt->resize(size);
-            std::memcpy(res->tuple, &tuple, sizeof(tuple));
-
-            comm.send(res->sender, pkt, comm.mh_tid); // always called from msg-handler
+            if (grant_remote(comm, pkt, tuple, comm.mh_tid)) { // always called from msg-handler
+                ++owner_cnt;
+                lock_type = mode;
+                owners.add_sorted(Owner{ts});
+            }
             WorkerContext::get().cntr.incr(stats::Counter::remote_lock_success);
-            return;
+            return ErrorCode::SUCCESS;
         }
 
 
-        bool can_wait = owners.empty() || (owners.head->val.ts > req->ts);
+        bool can_wait = owners.empty() || (owners.head->val.ts > ts);
         if (!can_wait) { // FAIL
-            auto res = req->convert<msg::TupleGetRes>();
-            res->mode = AccessMode::INVALID;
-            comm.send(res->sender, pkt, comm.mh_tid); // always called from msg-handler
+            const bool is_read = mode.get_clean() == AccessMode::READ;
+            refuse_remote(comm, pkt, comm.mh_tid); // always called from msg-handler
             WorkerContext::get().cntr.incr(stats::Counter::remote_lock_failed);
-            return;
+            return is_read ? ErrorCode::READ_LOCK_FAILED : ErrorCode::WRITE_LOCK_FAILED;
         }
 
 
         Waiter entry;
-        entry.mode = req->mode;
-        entry.ts = req->ts;
+        entry.mode = mode;
+        entry.ts = ts;
         entry.is_remote = true;
         entry.pkt = pkt; // union
 
         waiters.add_sorted(std::move(entry));
         WorkerContext::get().cntr.incr(stats::Counter::remote_lock_waiting);
+        return ErrorCode::SUCCESS;
     }
 
     void remote_unlock(msg::TuplePutReq* req, Communicator& comm) {
@@ -202,6 +200,15 @@ struct Row<Tuple_t, CC_Scheme::WAIT_DIE> {
             if (!is_compatible(entry.mode)) {
                 return false;
             }
+
+            if (entry.is_remote) {
+                auto pkt = entry.pkt;
+                if (!grant_remote(comm, pkt, tuple, my_tid)) { // cancelled, or a call that did not keep the lock
+                    return true;
+                }
+                WorkerContext::get().cntr.incr(stats::Counter::remote_lock_success);
+            }
+
             ++owner_cnt;
             lock_type = entry.mode;
             owners.add_sorted(Owner{entry.ts});
@@ -211,16 +218,6 @@ struct Row<Tuple_t, CC_Scheme::WAIT_DIE> {
                 // entry.future->tuple = &tuple;
                 entry.future->tuple.store(&tuple);
                 WorkerContext::get().cntr.incr(stats::Counter::local_lock_success);
-            } else {
-                auto pkt = entry.pkt;
-                auto req = pkt->template as<msg::TupleGetReq>();
-                auto res = req->template convert<msg::TupleGetRes>();
-                auto size = msg::TupleGetRes::size(sizeof(tuple));
-                pkt->resize(size);
-                std::memcpy(res->tuple, &tuple, sizeof(tuple));
-
-                comm.send(res->sender, pkt, my_tid);
-                WorkerContext::get().cntr.incr(stats::Counter::remote_lock_success);
             }
 
             return true;
@@ -2,12 +2,12 @@
 
 #include "comm/comm.hpp"
 #include "comm/msg.hpp"
+#include "access_sketch.hpp"
 #include "concurrency_control/no_wait.hpp"
 #include "concurrency_control/none.hpp"
 #include "concurrency_control/wait_die.hpp"
 #include "db/errors.hpp"
 #include "db/mempools.hpp"
-#include "db/undolog.hpp"
 #include "db/util.hpp"
 #include "partition.hpp"
 
@@ -16,9 +16,11 @@
 #include <cstring>
 #include <fstream>
 #include <iostream>
+#include <memory>
 #include <shared_mutex>
 #include <sstream>
 #include <string>
+#include <type_traits>
 #include <variant>
 
 
@@ -30,11 +32,17 @@ struct Table {
 
     p4db::table_t id;
     std::string name;
+    // sampled per-key-bucket accesses/conflicts, query at runtime
+    [[no_unique_address]] std::conditional_t<ENABLED_STATS & StatsBitmask::HEATMAP, AccessSketch, NoAccessSketch> sketch;
 
     // returns bytes written by tuple
     virtual size_t tuple_size() = 0;
-    virtual void remote_get(Communicator::Pkt_t* pkt, msg::TupleGetReq* req) = 0;
+    virtual void remote_get(Communicator::Pkt_t* pkt, msg::TupleMsgHeader* req) = 0; // TupleGetReq or TupleCallReq
     virtual void remote_put(msg::TuplePutReq* req) = 0;
+    virtual void remote_release(msg::TupleReleaseReq* req, const uint8_t* before) = 0; // before restores the tuple
+
+    // unlocks a local row, set by StructTable, for the Undolog without a virtual call
+    ErrorCode (*put_fn)(Table* table, p4db::key_t index, AccessMode mode, timestamp_t ts) = nullptr;
 
     virtual void print(){};
 };
@@ -52,8 +60,8 @@ struct Serializer {
         file.write(reinterpret_cast<const char*>(&val), sizeof(val));
     }
 
-    template <typename T>
-    void write(const std::unique_ptr<T>& val, const size_t size) {
+    template <typename T, typename D>
+    void write(const std::unique_ptr<T, D>& val, const size_t size) {
         static_assert(std::is_trivially_copyable<T>::value, "T must be a POD type.");
         file.write(reinterpret_cast<const char*>(val.get()), sizeof(*val.get()) * size); // sizeof(T) Error: incomplete type
     }
@@ -74,13 +82,45 @@ struct DeSerializer {
         return val;
     }
 
-    template <typename T>
-    void read(const std::unique_ptr<T>& val, const size_t size) {
+    template <typename T, typename D>
+    void read(const std::unique_ptr<T, D>& val, const size_t size) {
         static_assert(std::is_trivially_copyable<T>::value, "T must be a POD type.");
         file.read(reinterpret_cast<char*>(val.get()), sizeof(*val.get()) * size);
     }
 };
 
+// Frees the rows of a StructTable. With --zero_copy_bytes they live in dpdk
+// memory, so a remote read can chain the tuple to the reply without a copy.
+template <typename Row_t, typename Comm_t = Communicator>
+struct RowsDeleter {
+    Comm_t* dma = nullptr; // heap if not set
+    std::size_t count = 0;
+
+    void operator()(Row_t* rows) const {
+        if constexpr (requires { dma->free_dma(rows); }) {
+            if (dma) {
+                std::destroy_n(rows, count);
+                dma->free_dma(rows);
+                return;
+            }
+        }
+        delete[] rows;
+    }
+};
+
+template <typename Row_t, typename Comm_t>
+std::unique_ptr<Row_t[], RowsDeleter<Row_t, Comm_t>> make_rows(Comm_t& comm, std::size_t count, bool dma) {
+    if constexpr (requires { comm.alloc_dma(count); }) {
+        if (dma) {
+            auto rows = static_cast<Row_t*>(comm.alloc_dma(sizeof(Row_t) * count));
+            std::uninitialized_value_construct_n(rows, count);
+            return {rows, {&comm, count}};
+        }
+    }
+    return {new Row_t[count](), {}};
+}
+
+
 template <typename Tuple_t>
 struct StructTable final : public Table {
     using Row_t = Row<Tuple_t, CC_SCHEME>;
@@ -93,14 +133,24 @@ struct StructTable final : public Table {
 
     Tuple_t::PartitionInfo_t part_info;
     Communicator& comm;
-    std::unique_ptr<Row_t[]> data;
+    std::unique_ptr<Row_t[], RowsDeleter<Row_t>> data;
     // HugePages<Row_t> data;
 
 
     StructTable(std::size_t max_size, Communicator& comm)
         : max_size(max_size), part_info(max_size), comm(comm) {
+        if (max_size > msg::wire::MAX_KEYS) {
+            throw std::invalid_argument("table exceeds the 48 bit keys of tuple messages");
+        }
+        if (msg::TupleGetRes::size(sizeof(Tuple_t)) > msg::wire::MAX_MSG_SIZE) {
+            throw std::invalid_argument("tuple does not fit into one message, tuples larger than an MTU are not supported");
+        }
         std::cout << "size: " << stringifyFileSize(sizeof(Row_t) * max_size) << '\n';
-        data = std::make_unique<Row_t[]>(max_size);
+        auto zero_copy_bytes = Config::instance().zero_copy_bytes;
+        data = make_rows<Row_t>(comm, max_size, zero_copy_bytes > 0 && sizeof(Tuple_t) >= zero_copy_bytes);
+        put_fn = [](Table* table, p4db::key_t index, AccessMode mode, timestamp_t ts) {
+            return static_cast<StructTable*>(table)->put(index, mode, ts);
+        };
         // data.allocate(max_size);
     }
 
@@ -151,7 +201,11 @@ struct StructTable final : public Table {
         }
 
         auto& row = data[local_index];
-        return row.local_lock(mode, ts, future);
+        auto rc = row.local_lock(mode, ts, future);
+        if constexpr (ENABLED_STATS & StatsBitmask::HEATMAP) {
+            sketch.record(local_index, rc != ErrorCode::SUCCESS);
+        }
+        return rc;
     }
 
     ErrorCode put(p4db::key_t index, const AccessMode mode, const timestamp_t ts) {
@@ -180,10 +234,13 @@ struct StructTable final : public Table {
     }
 
 
-    virtual void remote_get(Communicator::Pkt_t* pkt, msg::TupleGetReq* req) override {
+    virtual void remote_get(Communicator::Pkt_t* pkt, msg::TupleMsgHeader* req) override {
         auto local_index = part_info.translate(req->rid);
         auto& row = data[local_index];
-        row.remote_lock(comm, pkt, req);
+        auto rc = row.remote_lock(comm, pkt, req);
+        if constexpr (ENABLED_STATS & StatsBitmask::HEATMAP) {
+            sketch.record(local_index, rc != ErrorCode::SUCCESS);
+        }
     }
 
     virtual void remote_put(msg::TuplePutReq* req) override {
@@ -200,6 +257,15 @@ struct StructTable final : public Table {
         row.remote_unlock(req, comm);
     }
 
+    virtual void remote_release(msg::TupleReleaseReq* req, const uint8_t* before) override {
+        auto& row = data[part_info.translate(req->rid)];
+        if (before) {
+            std::memcpy(&row.tuple, before, sizeof(Tuple_t)); // still locked by the call
+        }
+        auto rc = row.local_unlock(req->mode, req->ts, comm);
+        (void)rc;
+    }
+
     virtual size_t tuple_size() override {
         return sizeof(Tuple_t);
     }
@@ -15,26 +15,33 @@ class Headers(Snippet):
         ether_type_t ether_type;
     }
 
-    enum bit<32> MsgType_t {
+    enum bit<8> MsgType_t {
         // Handled by System
-        INIT = 0x01000100,
-        BARRIER = 0x02000100,
+        INIT = 0x81,
+        BARRIER = 0x82,
 
-        TUPLE_GET_REQ  = 0x01000000,
-        TUPLE_GET_RES = 0x02000000,
-        TUPLE_PUT_REQ  = 0x03000000,
-        TUPLE_PUT_RES = 0x04000000,
+        TUPLE_GET_REQ  = 0x01,
+        TUPLE_GET_RES = 0x02,
+        TUPLE_PUT_REQ  = 0x03,
+        TUPLE_PUT_RES = 0x04,
 
-        SWITCH_TXN = 0x05000000
+        SWITCH_TXN = 0x05,
+
+        TUPLE_CALL_REQ = 0x06,
+        TUPLE_CALL_RES = 0x07,
+        TUPLE_RELEASE_REQ = 0x08
     }
 
 
-    typedef bit<32> node_t;
-    typedef bit<64> msgid_t;
+    typedef bit<16> node_t;
+    typedef bit<32> msgid_t;
 
     header msg_t {
         bit<16> padding;    // 14 bytes for eth_hdr_t, add 2 bytes
         MsgType_t type;
+        bit<4> version;    // msg::WIRE_VERSION
+        bit<3> flags;
+        bit<1> has_ts;     // tuple msgs carry a timestamp (wait_die)
         node_t sender;
         msgid_t msg_id;
     }
@@ -47,13 +54,20 @@ class Headers(Snippet):
 
 
     header tuple_msg_t {
-        bit<64> ts;
-        bit<64> tid;
-        bit<64> rid;
+        bit<16> tid;
+        bit<48> rid;
         AccessMode_t mode;
         bit<8> by_switch;
         bit<16> lock_idx;
-        // tuple_data is optional payload
+        // tuple_ts_t only if msg.has_ts, tuple_data is optional payload
+    }
+
+    header tuple_ts_t {
+        bit<64> ts;
+    }
+
+    header pad_t {
+        bit<32> padding;    // tuple_data is 8 byte aligned
     }
 
 
@@ -67,6 +81,8 @@ class Headers(Snippet):
         msg_t msg;
         tuple_msg_t tuple_get_req;
         tuple_msg_t tuple_put_req;
+        tuple_ts_t ts;
+        pad_t pad;
         tuple_t data;
     }
 
@@ -114,17 +130,37 @@ class Parser(Snippet):
 
         state parse_tuple_get_req {
             pkt.extract(hdr.tuple_get_req);
+            transition select(hdr.msg.has_ts) {
+                1: parse_ts;
+                default: accept;
+            }
+        }
+
+        state parse_ts {
+            pkt.extract(hdr.ts);
             transition accept;
         }
 
         state parse_tuple_put_req {
             pkt.extract(hdr.tuple_put_req);
-            transition select(hdr.tuple_put_req.mode) {
-                AccessMode_t.WRITE: parse_data;
+            transition select(hdr.msg.has_ts, hdr.tuple_put_req.mode) {
+                (1, AccessMode_t.WRITE): parse_put_ts;
+                (1, _): parse_ts;
+                (0, AccessMode_t.WRITE): parse_pad;
                 default: accept;
             }
         }
 
+        state parse_put_ts {
+            pkt.extract(hdr.ts);
+            transition parse_pad;
+        }
+
+        state parse_pad {
+            pkt.extract(hdr.pad);
+            transition parse_data;
+        }
+
         state parse_data {
             pkt.extract(hdr.data);
             transition accept;
@@ -178,6 +214,7 @@ class Ingress(Snippet):
 
                 hdr.msg.type = MsgType_t.TUPLE_GET_RES;
                 if (granted == 1) {
+                    hdr.pad.setValid();
                     hdr.data.setValid();
                     ${reads}
                 } else {
@@ -190,6 +227,7 @@ class Ingress(Snippet):
                 if (hdr.data.isValid()) {
                     ${writes}
                     hdr.data.setInvalid();
+                    hdr.pad.setInvalid();
                 }
                 hdr.msg.type = MsgType_t.TUPLE_PUT_RES;
 
@@ -20,25 +20,32 @@ class Headers(Snippet):
     }
 
 
-    enum bit<32> MsgType_t {
+    enum bit<8> MsgType_t {
         // Handled by System
-        INIT = 0x01000100,
-        BARRIER = 0x02000100,
+        INIT = 0x81,
+        BARRIER = 0x82,
 
-        TUPLE_GET_REQ  = 0x01000000,
-        TUPLE_GET_RES = 0x02000000,
-        TUPLE_PUT_REQ  = 0x03000000,
-        TUPLE_PUT_RES = 0x04000000,
+        TUPLE_GET_REQ  = 0x01,
+        TUPLE_GET_RES = 0x02,
+        TUPLE_PUT_REQ  = 0x03,
+        TUPLE_PUT_RES = 0x04,
 
-        SWITCH_TXN = 0x05000000
+        SWITCH_TXN = 0x05,
+
+        TUPLE_CALL_REQ = 0x06,
+        TUPLE_CALL_RES = 0x07,
+        TUPLE_RELEASE_REQ = 0x08
     }
 
-    typedef bit<32> node_t;
-    typedef bit<64> msgid_t;
+    typedef bit<16> node_t;
+    typedef bit<32> msgid_t;
 
     header msg_t {
         bit<16> padding;    // 14 bytes for eth_hdr_t, add 2 bytes
         MsgType_t type;
+        bit<4> version;    // msg::WIRE_VERSION
+        bit<3> flags;
+        bit<1> has_ts;     // tuple msgs carry a timestamp (wait_die)
         node_t sender;
         msgid_t msg_id;
     }